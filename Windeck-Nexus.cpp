@@ -3,13 +3,24 @@
 #include <windows.h>
 #include <shellapi.h>
 #include <XInput.h>
+#include <intrin.h>
+#include <algorithm>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <charconv>
+#include <climits>
+#include <cwctype>
 #include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
-#include <filesystem>
-#include <fstream>
-#include <sstream>
-#include <regex>
 #include <wrl.h>
 #include <WebView2.h>
 
@@ -19,14 +30,334 @@
 #pragma comment(lib, "XInput.lib")
 #pragma comment(lib, "advapi32.lib")
 
-struct Game { std::wstring name, path, appId; };
+// sizeOnDisk, lastUpdated (Unix time), bytesToDownload, buildId and stateFlags come from Steam manifests; lastPlayed (Unix time)
+// and playtimeMinutes from the users' localconfig.vdf. All stay 0 elsewhere. source names the scanner that found the entry;
+// launchOptions and startDir come from a shortcut or a Steam app's launch config, art (a local image path) from shortcut grid art.
+// A ROM's path is its emulator and its appId the ROM's CRC32 in hex or "serial:" and a disc's serial (see RomAppId). foundBy lists
+// every scanner that reported the same install, the kept record's first (see MergeDuplicateGames).
+struct Game {
+    std::wstring name, path, appId;
+    uint64_t sizeOnDisk = 0, lastUpdated = 0, bytesToDownload = 0; uint32_t buildId = 0, stateFlags = 0;
+    uint64_t lastPlayed = 0, playtimeMinutes = 0;
+    std::wstring source, launchOptions, startDir, art;
+    std::vector<std::wstring> foundBy;
+};
+// appmanifest StateFlags bits. Anything in kAppStateBusyMask means Steam is rewriting the install right now.
+const uint32_t kAppStateUpdateRequired = 0x2, kAppStateFullyInstalled = 0x4, kAppStateBusyMask = 0xFF0F00;
+// Steam KeyValues (VDF/ACF) text parsed in place: keys and values are views into the caller's buffer, node 0 is the document root.
+struct KvNode { std::string_view key, value; int firstChild = -1, nextSibling = -1; bool isBlock = false; };
+struct KvTree {
+    std::vector<KvNode> nodes;
+    int Find(int parent, std::string_view key) const;
+    std::string_view Get(int parent, std::string_view key) const;
+};
+// One Steam library folder; appIds come from the "apps" map in libraryfolders.vdf when Steam wrote one.
+struct SteamLibrary { std::wstring path; std::vector<std::wstring> appIds; bool hasAppMap = false; };
+struct FileStamp { uint64_t mtime = 0, size = 0; };
+struct SteamPlaytime { uint64_t lastPlayed = 0, minutes = 0; };
+// Cursor over Steam's binary KeyValues (shortcuts.vdf, appinfo.vdf): per entry a type byte, the key, then the value. Keys are
+// NUL-terminated strings unless keyTable is set, in which case they are 32-bit indices into it. Reads past `end` yield nothing.
+enum : uint8_t { kBinKvMap = 0, kBinKvString = 1, kBinKvInt32 = 2, kBinKvFloat = 3, kBinKvPointer = 4, kBinKvWideString = 5, kBinKvColor = 6, kBinKvUInt64 = 7, kBinKvEnd = 8, kBinKvInt64 = 10, kBinKvEndAlt = 11 };
+struct BinaryKvReader {
+    const uint8_t* p; const uint8_t* end;
+    const std::vector<std::string_view>* keyTable = nullptr;
+    bool Next(uint8_t& type, std::string_view& key);
+    std::string_view String();
+    uint32_t Int32();
+    uint64_t UInt64();
+    void Skip(uint8_t type);
+};
+// Read-only mapping of a whole file. Writers and deleters are not locked out, so Steam can replace a file we are reading.
+struct MappedFile {
+    bool Open(const std::wstring& path); void Close();
+    ~MappedFile() { Close(); }
+    HANDLE file = INVALID_HANDLE_VALUE, mapping = nullptr;
+    const uint8_t* data = nullptr; size_t size = 0;
+};
+// Cursor over one directory listing: FindFirstFileExW with FindExInfoBasic (no 8.3 names) and FIND_FIRST_EX_LARGE_FETCH (large
+// batches per kernel call). Each entry carries the attributes, size and write time the listing already returned, so scanners
+// never stat a file. `name` points into the reader and stays valid until the next call to Next; "." and ".." are skipped.
+struct DirEntry { const wchar_t* name; uint64_t size, mtime; bool isDirectory, isReparsePoint; };
+struct DirectoryReader {
+    bool Open(const std::wstring& dir), Next(DirEntry& entry);
+    ~DirectoryReader() { if (find != INVALID_HANDLE_VALUE) FindClose(find); }
+    HANDLE find = INVALID_HANDLE_VALUE;
+    WIN32_FIND_DATAW data;
+    bool pending = false;
+};
+// appcache\appinfo.vdf: the store metadata of every app the client has seen, often 100+ MB. Open maps it and records where each
+// app's binary KeyValues start; Find decodes just that one app. The views stay valid while the file is open.
+const uint32_t kAppInfoMagicV27 = 0x07564427, kAppInfoMagicV28 = 0x07564428, kAppInfoMagicV29 = 0x07564429;
+struct SteamLaunchOption { std::string_view executable, arguments, workingDir, type, oslist, osarch, betaKey; };
+struct SteamAppInfo { std::string_view name, type, installDir; std::vector<SteamLaunchOption> launch; };
+struct SteamAppInfoFile {
+    bool Open(const std::wstring& path), Find(uint32_t appId, SteamAppInfo& info) const;
+    MappedFile mapped;
+    uint32_t magic = 0;
+    std::vector<std::string_view> keyTable;
+    std::unordered_map<uint32_t, std::pair<size_t, size_t>> entries; // appid -> offset and size of its KeyValues
+};
+// The one SteamAppInfoFile every manifest shares, opened by the first manifest that misses the library cache and kept until
+// Steam rewrites appinfo.vdf, so warm scans never index it and the watcher's batches reuse the startup scan's index. A file
+// that cannot be opened is remembered as an empty index until its stamp moves.
+struct SteamAppInfoIndex {
+    std::shared_ptr<const SteamAppInfoFile> Get(const std::wstring& path);
+    std::mutex lock;
+    std::wstring path;
+    FileStamp stamp;
+    std::shared_ptr<const SteamAppInfoFile> file;
+};
+// What an .exe's headers and version resource say about it, read without running it (see ParsePeHeaders). machine and subsystem
+// are the raw IMAGE_FILE_MACHINE_* and IMAGE_SUBSYSTEM_* values; isDll is IMAGE_FILE_DLL, a library renamed or built as .exe;
+// installerStub marks an Authenticode-signed setup package.
+const uint16_t kPeMachineAmd64 = 0x8664, kPeMachineArm64 = 0xAA64, kPeSubsystemGui = 2, kPeSubsystemConsole = 3, kPeFileDll = 0x2000;
+const size_t kPeHeaderBytes = 4096, kPeResourceBytes = 65536, kPeVersionBytes = 16384;
+struct PeInfo { uint16_t machine = 0, subsystem = 0; bool isDll = false, isSigned = false, installerStub = false; std::wstring productName, fileDescription; };
+// Folders no tree walk descends into: the built-in kDefaultExclusions plus one pattern per line from scan-exclusions.txt next to
+// the exe. A pattern without a slash matches a folder name at any depth; one with a slash matches the trailing components of
+// the folder's path below the walk root. * and ? work in both, and case is ignored. Literal patterns, the common case, cost
+// one hash lookup; only wildcard patterns are matched one by one. A built-in pattern is ignored for a game whose MatchKey
+// contains the pattern's own letters, so Crash Bandicoot's folders are still walked.
+struct ExclusionSet {
+    void Add(std::wstring_view pattern, bool builtIn = false);
+    bool Excludes(std::wstring_view relativePath, std::wstring_view gameKey = {}) const;
+    std::unordered_map<std::wstring, std::wstring> names, paths;             // pattern -> MatchKey of a built-in one, else empty
+    std::vector<std::pair<std::wstring, std::wstring>> nameGlobs, pathGlobs; // Likewise
+    uint32_t signature = 0; // CRC32 of every pattern added, in order
+};
+// Registry reads used by the scanners. Keys are full paths ("HKEY_LOCAL_MACHINE\\SOFTWARE\\...", HKLM and HKCU also work) and
+// view is KEY_WOW64_32KEY/64KEY. The live registry is used unless LoadSnapshot filled `snapshot` from an exported .reg file
+// (regedit writes UTF-16, REGEDIT4 files are 8-bit), which lets a scan run against another machine's registry. A 32-bit view
+// of a snapshot is redirected to WOW6432Node when the export has one; snapshots carry no last-write times. Missing values come
+// back as REG_NONE.
+struct RegistryValue { DWORD type = REG_NONE; std::wstring text; uint64_t number = 0; };
+struct RegistrySubkey { std::wstring name; uint64_t lastWrite = 0; };
+struct RegistrySnapshotKey { std::unordered_map<std::wstring, RegistryValue> values; std::vector<std::wstring> children; };
+struct Registry {
+    bool LoadSnapshot(const std::wstring& path);
+    bool ReadValues(const std::wstring& key, const std::vector<const wchar_t*>& names, std::vector<RegistryValue>& values, REGSAM view = 0) const;
+    bool ListSubkeys(const std::wstring& key, std::vector<RegistrySubkey>& subkeys, REGSAM view = 0) const;
+    std::wstring ReadString(const std::wstring& key, const wchar_t* name, REGSAM view = 0) const;
+    RegistrySnapshotKey& AddSnapshotKey(std::wstring_view path);
+    const RegistrySnapshotKey* FindSnapshotKey(const std::wstring& key, REGSAM view) const;
+    std::unordered_map<std::wstring, RegistrySnapshotKey> snapshot; // by lower-cased path, values by lower-cased name
+    bool fromSnapshot = false;
+};
+// Background threads shared by the scanners, started on first use. ParallelFor hands out indices from an atomic counter and
+// the calling thread works through them too, so nested or concurrent calls still finish when every worker is busy.
+struct WorkerPool {
+    void ParallelFor(size_t count, const std::function<void(size_t)>& body), WorkerLoop();
+    std::mutex lock;
+    std::condition_variable wake;
+    std::deque<std::function<void()>> jobs;
+    size_t workerCount = 0;
+};
+// On-disk library cache (library.cache next to the exe), memory-mapped on load. Each record remembers the Game a manifest or
+// Uninstall subkey produced (an empty path means "not a game") with the stamp it was read at: a manifest's (mtime, size) or
+// a registry key's last-write time. Only sources whose stamp moved get parsed again. Exe records remember which executable an
+// install folder resolved to (empty if none), valid while the folder's mtime and the exe's (mtime, size) are unchanged.
+// pickSignature covers what else decides an exe pick, the exclusions and kExeScoringVersion: a cache written under another one
+// keeps only its ROM records, which no pick went into. Bump kExeScoringVersion whenever a scoring change can move a pick.
+const uint32_t kScanCacheMagic = 0x4B434457, kScanCacheVersion = 9, kExeScoringVersion = 3;
+struct ScanCacheHeader { uint32_t magic, version, recordCount, exeCount, stringCount, pickSignature; };
+struct ScanCacheString { uint32_t offset, length; };
+struct ScanCacheRecord { uint64_t stamp, size, sizeOnDisk, lastUpdated, bytesToDownload; uint32_t buildId, stateFlags; ScanCacheString key, name, path, appId, source, launchOptions, startDir, art; };
+struct ScanCacheExeRecord { uint64_t dirMtime, exeMtime, exeSize; ScanCacheString dir, exe; };
+struct ScanCacheEntry { std::wstring key; FileStamp stamp; Game game; };
+struct ScanCacheExeEntry { std::wstring dir, exe; uint64_t dirMtime = 0; FileStamp exeStamp; };
+struct SteamManifestResult { std::wstring manifestPath; FileStamp stamp; Game game; bool read = false; };
+// One Uninstall subkey on its way through FindRegistryGames. The values are only read when the cache has no answer for it.
+struct UninstallEntry {
+    std::wstring cacheKey, keyPath; REGSAM view = 0; FileStamp stamp;
+    std::wstring name, location, publisher, icon; uint64_t estimatedSizeKb = 0; bool systemComponent = false, isPatch = false;
+    Game game; bool cached = false, stored = true;
+};
+// Declarative rules that tell games from everything else in Uninstall (see kUninstallRules). Every rule whose text occurs in its
+// field adds its weight; text starting with '=' must equal the whole field instead. Compiled once: patterns are folded to lower
+// case and grouped by field, so each field of an entry is folded once and then searched with plain substring finds.
+enum UninstallField : uint8_t { kFieldKey, kFieldName, kFieldPublisher, kFieldLocation, kFieldIcon, kFieldCount };
+struct UninstallRule { UninstallField field; const wchar_t* text; int weight; };
+struct UninstallPattern { std::wstring text; int weight; bool exact; };
+struct UninstallClassifier {
+    std::vector<UninstallPattern> patterns[kFieldCount];
+    int Score(const UninstallEntry& entry) const;
+};
+// The Uninstall key as seen from each registry view: 64-bit installers, 32-bit ones (WOW6432Node) and per-user installs, where
+// many indie launchers land. The first view keeps the cache keys it has always had.
+struct UninstallView { const wchar_t* hive; const wchar_t* cachePrefix; REGSAM view; };
+const wchar_t* const kUninstallKey = L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Uninstall";
+const UninstallView kUninstallViews[] = { {L"HKEY_LOCAL_MACHINE", L"HKLM", KEY_WOW64_64KEY}, {L"HKEY_LOCAL_MACHINE", L"HKLM32", KEY_WOW64_32KEY}, {L"HKEY_CURRENT_USER", L"HKCU", 0} };
+const size_t kUninstallViewCount = sizeof(kUninstallViews) / sizeof(kUninstallViews[0]);
+// Change notifications that keep the library current after the startup scan (see WatchLibrary). A ChangeWatch is one source:
+// a directory read with ReadDirectoryChangesW or a registry key armed with RegNotifyChangeKeyValue. Both are one-shot and
+// signal an event, so ChangeWatcher waits on all of them at once and re-arms whichever fired. Watches live on the heap since
+// a pending read holds on to their OVERLAPPED and buffer. A ChangeEvent lists the file names a directory reported; overflow
+// means it lost track (too many changes at once, or the folder went away) and has to be listed again.
+const DWORD kChangeBufferBytes = 65536, kWatchSettleMs = 500;
+struct ChangeWatch {
+    bool Arm();
+    ~ChangeWatch();
+    std::wstring path; REGSAM view = 0;
+    HANDLE event = nullptr, directory = INVALID_HANDLE_VALUE; HKEY key = nullptr;
+    OVERLAPPED overlapped = {};
+    std::vector<DWORD> buffer; // FILE_NOTIFY_INFORMATION records, which must be DWORD-aligned
+};
+struct ChangeEvent { std::wstring path; REGSAM view = 0; bool isKey = false, overflow = false; std::vector<std::wstring> names; };
+struct ChangeWatcher {
+    bool AddDirectory(const std::wstring& dir), AddKey(const std::wstring& key, REGSAM view), Wait(DWORD timeout, ChangeEvent& change);
+    std::vector<std::unique_ptr<ChangeWatch>> watches;
+};
+// What each manifest or Uninstall subkey (keyed as in the scan cache) produced when it was last read: its stamp and the game
+// it added to the library, with no path if none. Owned by the scan, then by the watcher thread.
+struct LibrarySource { FileStamp stamp; Game game; };
+// One incremental update for the window thread. previous is what the source supplied before (no path: nothing); if game is not
+// the same install, previous's scanner leaves the record it went into, unless keepScanner says another of its sources still
+// supplies that install, and the record goes with its last scanner. Then game (if it has a path) is added or folded in.
+struct LibraryChange { Game previous; bool keepScanner = false; Game game; };
+// Paths as the file system resolves them (GetFinalPathNameByHandleW), so an install reached through a junction, a symlinked
+// library folder or a second drive letter has one key. Only the folder is resolved, once, since launchers link folders rather
+// than exes; the file name is just folded like the rest of NormalizePathKey.
+struct CanonicalPaths {
+    std::mutex lock;
+    std::unordered_map<std::wstring, std::wstring> folders; // NormalizePathKey of a folder -> NormalizePathKey of its final path
+    std::wstring Key(std::wstring_view path);
+};
+// One provider's share of a scan (see kGameProviders). The provider fills games, claims (install folders it resolved exactly,
+// see IsClaimedInstall) and sources (see g_librarySources) and stops early once cancelled is set. The rest belongs to the scan
+// and is guarded by its lock.
+struct ProviderRun {
+    std::vector<Game> games;
+    std::vector<std::wstring> claims;
+    std::vector<std::pair<std::wstring, LibrarySource>> sources;
+    std::atomic<bool> cancelled{false};
+    bool done = false, late = false; // late: still running when ScanForGames stopped waiting for it
+};
+struct GameProvider { const wchar_t* name; void (*find)(ProviderRun& run); uint32_t budgetMs; bool yieldsToClaims; };
+// Shared by ScanForGames and the provider threads, which may outlive it.
+struct ProviderScan {
+    std::vector<ProviderRun> runs;
+    std::mutex lock;
+    std::condition_variable finished;
+};
+// Cursor over Protocol Buffers wire format, read in place with no schema or runtime. Next gives each field's number and wire
+// type; length-delimited payloads (strings, nested messages) come back as views into the buffer, and a nested message is read
+// by a ProtoReader over its view. Malformed or truncated input ends the message.
+enum : uint8_t { kProtoVarint = 0, kProtoFixed64 = 1, kProtoBytes = 2, kProtoFixed32 = 5 };
+struct ProtoReader {
+    const uint8_t* p; const uint8_t* end;
+    bool Next(uint32_t& field, uint8_t& wireType);
+    uint64_t Varint();
+    std::string_view Bytes();
+    void Skip(uint8_t wireType);
+};
+// Battle.net's Agent\product.db is a ProductDb message. Only these fields are decoded: Database.product_install (1) ->
+// ProductInstall.product_code (2), .settings (3) -> UserSettings.install_path (1), and .cached_product_state (4) ->
+// CachedProductState.base_product_state (1) -> BaseProductState.installed (1), .playable (2), .current_version_str (7).
+// The views point into the mapped file.
+const uint32_t kPdbProductInstall = 1, kPdbProductCode = 2, kPdbSettings = 3, kPdbCachedState = 4, kPdbInstallPath = 1, kPdbBaseState = 1,
+    kPdbInstalled = 1, kPdbPlayable = 2, kPdbVersion = 7;
+struct BattleNetProduct { std::string_view code, installPath, version; bool installed = false, playable = false; };
+// An Epic .item manifest as the launcher wrote it (see ParseEpicManifest). exePath joins InstallLocation and LaunchExecutable
+// and is not checked on disk. isGame is cleared for what the launcher installs besides games: the Unreal Engine and tools
+// (AppCategories without "games", bIsExecutable false) and add-ons, whose MainGameAppName names the game they belong to.
+struct EpicManifest { std::wstring displayName, appName, exePath, launchCommand; uint64_t installSize = 0; bool incomplete = false, isGame = true; };
+// A GOG install as the GOG.com registry key or Galaxy's database lists it. The goggame-<id>.info file in the folder has the
+// final word on the name and exe; exe, arguments and workingDir here are the registry's fallback.
+struct GogInstall { std::wstring folder, name, gameId, exe, arguments, workingDir; };
+// One line of roms.txt next to the exe: ROM folder | emulator exe | arguments | extensions | DAT file. {rom} in the arguments
+// becomes the ROM's full path (the default is "{rom}"); extensions is a comma-separated list such as sfc,smc,zip and
+// defaults to any file that is not obviously a side file (kRomSideExtensions). The DAT is optional.
+struct RomSystem { std::wstring folder, emulator, arguments, datPath; std::vector<std::wstring> extensions; };
+// A Logiqx XML DAT, the format No-Intro and Redump publish, reduced to what identification needs: each rom's CRC32 and size
+// mapped to the name of its game. A disc game lists every track, so any one of them identifies it.
+struct RomDat {
+    bool Load(const std::wstring& path);
+    const std::wstring* Find(uint32_t crc, uint64_t size) const;
+    const std::wstring* FindSerial(std::string_view serial) const;
+    std::vector<std::wstring> names;
+    std::unordered_map<uint64_t, uint32_t> roms; // crc << 32 | low 32 bits of size -> index into names
+    std::unordered_map<std::string, uint32_t> serials; // NormalizeSerial of a game's serial element or attribute -> index into names
+    FileStamp stamp;
+};
+// A candidate file under a ROM folder and what identifying it found: the DAT name (or the file name without its extension)
+// and either the CRC32 of the file or of the archive member that matched, or a disc's serial. stored is cleared when a
+// cancelled scan skipped it.
+struct RomFile { std::wstring path; FileStamp stamp; size_t system = 0; std::wstring name, crc, serial; bool stored = true; };
+// What an archive's own directory says about a member: no decompression is involved.
+struct ArchiveMember { uint32_t crc; uint64_t size; };
+// What a disc image's own headers say: the serial the console knows it by (SLUS-00594, GALE01) and, where the disc carries
+// one, its title. Found by reading a few sectors (see ReadDiscInfo), never by hashing the image.
+struct DiscInfo { std::string serial; std::wstring title; };
+// 2048-byte data sectors of a CD or DVD image, read one at a time at their offsets: a flat .iso, a raw 2352-byte .bin (Mode 1
+// or Mode 2 Form 1, told apart by the sync pattern and mode byte), the first track a .cue names, or an uncompressed CHD, whose
+// hunk map is read one entry at a time. Compressed CHD hunks need the codecs chdman used, so those images read nothing.
+struct DiscImage {
+    bool Open(const std::wstring& path), ReadAt(uint64_t offset, void* out, size_t size), ReadSector(uint32_t lba, uint8_t* out);
+    bool ReadUnit(uint32_t lba, uint32_t offset, void* out, size_t size);
+    ~DiscImage() { if (file != INVALID_HANDLE_VALUE) CloseHandle(file); }
+    HANDLE file = INVALID_HANDLE_VALUE;
+    uint32_t unitBytes = 2048, dataOffset = 0; // Bytes per sector as stored, and where its 2048 data bytes start
+    uint32_t chdHunkBytes = 0;                 // Nonzero for a CHD, whose sectors live in hunks located through its map
+    uint64_t chdMapOffset = 0, bytesRead = 0;
+};
+const size_t kChdV5HeaderBytes = 124, kGameCubeHeaderBytes = 0x100, kWiaDiscHeaderOffset = 0x58, kWiaDiscHeaderBytes = 0x80;
+const uint32_t kIsoSectorBytes = 2048, kCdRawSectorBytes = 2352, kIsoDescriptorSector = 16, kGameCubeMagic = 0xC2339F3D, kWiiMagic = 0x5D1C9EA3;
+// Running totals for FindRomGames' report.
+struct RomScanStats { std::atomic<uint64_t> hashedBytes{0}, discBytes{0}, discs{0}; };
+// One line of playlists.txt next to the exe: list | emulator | arguments | ROM folder. The list is a RetroArch playlist (.lpl),
+// a folder of them, or an ES-DE gamelist.xml. {rom} and {core} in the arguments become an entry's content path and libretro
+// core; the defaults are -L "{core}" "{rom}" for playlists and "{rom}" for gamelists, and a playlist's emulator defaults to
+// retroarch.exe beside its playlists folder. Relative content paths resolve against the ROM folder, by default the list's own.
+struct PlaylistSource { std::wstring list, emulator, arguments, romFolder; bool retroArch = false; };
+// 7z header property ids (7zFormat.txt) and a cursor over the header's NUMBER-encoded fields. Malformed input clears ok.
+const uint8_t k7zEnd = 0x00, k7zHeader = 0x01, k7zArchiveProperties = 0x02, k7zAdditionalStreams = 0x03, k7zMainStreams = 0x04, k7zFilesInfo = 0x05,
+    k7zPackInfo = 0x06, k7zUnpackInfo = 0x07, k7zSubStreamsInfo = 0x08, k7zSize = 0x09, k7zCrc = 0x0A, k7zFolder = 0x0B, k7zCodersUnpackSize = 0x0C,
+    k7zNumUnpackStream = 0x0D, k7zEmptyStream = 0x0E;
+struct SevenZipReader {
+    const uint8_t* p; const uint8_t* end;
+    bool ok = true;
+    uint8_t Byte();
+    uint64_t Number();
+    uint32_t UInt32();
+    void Skip(uint64_t size);
+    bool Fits(uint64_t count) { ok = ok && count <= (uint64_t)(end - p) * 8; return ok; } // Guards allocations sized by the input
+    std::vector<bool> Bits(size_t count), Defined(size_t count);
+};
+const size_t kRomReadBytes = 1 << 20, kRomSearchDepth = 4, kRomSheetMaxBytes = 64 << 10;
+struct ScanCache {
+    bool Load(const std::wstring& path), Lookup(const std::wstring& key, const FileStamp& stamp, Game& game) const, Save(const std::wstring& path);
+    bool LookupExe(const std::wstring& dir, ScanCacheExeEntry& entry) const;
+    void Store(const std::wstring& key, const FileStamp& stamp, const Game& game), StoreExe(const ScanCacheExeEntry& entry), Forget(const std::wstring& key), Close();
+    MappedFile mapped;
+    const ScanCacheRecord* records = nullptr;
+    const ScanCacheExeRecord* exeRecords = nullptr;
+    const wchar_t* strings = nullptr;
+    uint32_t stringCount = 0, pickSignature = 0; // pickSignature: the current exclusions' and scoring's, set before Load
+    std::unordered_map<std::wstring_view, uint32_t> index, exeIndex;
+    std::mutex freshLock, freshExesLock; // Providers store concurrently, and StoreExe runs on pool workers
+    // Everything the next Save writes. Kept after saving, so the watcher's later saves write the whole library again.
+    std::unordered_map<std::wstring, ScanCacheEntry> fresh; // by key; a later store replaces an earlier one
+    std::vector<ScanCacheExeEntry> freshExes;               // The last entry for a folder wins
+};
 HWND g_hWnd = nullptr, g_guideshWnd = nullptr;
 Microsoft::WRL::ComPtr<ICoreWebView2Controller> g_webviewController;
 Microsoft::WRL::ComPtr<ICoreWebView2> g_webview;
 bool g_isFrontendVisible = false, g_isAppRunning = true;
 std::vector<Game> g_gameLibrary;
+ScanCache g_scanCache;
+SteamAppInfoIndex g_steamAppInfo;
+ExclusionSet g_exclusions;
+Registry g_registry;
+WorkerPool& g_workerPool = *new WorkerPool(); // Never destroyed: its detached threads still wait on it while the process exits.
+std::unordered_map<std::wstring, LibrarySource> g_librarySources;
+std::unordered_set<std::wstring> g_claimedInstalls; // NormalizePathKey of folders a launcher provider already turned into games
+std::shared_ptr<ProviderScan> g_providerScan;
+CanonicalPaths g_canonicalPaths;
+std::mutex g_libraryChangesLock;
+std::vector<LibraryChange> g_libraryChanges;
 
 #define WM_APP_TRAY_MSG (WM_APP + 1)
+#define WM_APP_LIBRARY_CHANGED (WM_APP + 2)
 #define TRAY_ICON_ID 1
 #define ID_MENU_SHOW 1001
 #define ID_MENU_CONFIG 1002
@@ -36,11 +367,91 @@ NOTIFYICONDATAW g_nid = {};
 LRESULT CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM);
 LRESULT CALLBACK GuidesWndProc(HWND, UINT, WPARAM, LPARAM);
 void CreateTrayIcon(), ShowContextMenu(HWND), ToggleFrontendVisibility(), CreateGuidesWindow(HINSTANCE);
-void ControllerInputThread(), ScanForGames(), FindSteamGames(), FindRegistryGames();
+void ControllerInputThread(), ScanForGames(), WatchLibrary(), ApplyLibraryChanges(), FinishProviderScan(), CancelProviderScan();
+void FindSteamGames(ProviderRun& run), FindEpicGames(ProviderRun& run), FindGogGames(ProviderRun& run), FindBattleNetGames(ProviderRun& run), FindRegistryGames(ProviderRun& run);
+void RunProvider(ProviderScan& scan, size_t index), MergeProviderRuns(ProviderScan& scan, bool late, std::vector<Game>& games, std::vector<LibraryChange>& changes);
 void SendKey(WORD vkey);
-std::wstring GetExecutablePath(), GetSteamInstallPath(), FindExecutableInDir(const std::wstring& dirPath);
+std::wstring GetExecutablePath(), GetProgramDataPath(), GetSteamInstallPath(), FindExecutableInDir(const std::wstring& dirPath, std::wstring_view gameName), ResolveExecutable(const std::wstring& dirPath, std::wstring_view gameName);
+bool ReadFileBytes(const std::wstring& path, std::string& out), ParseKeyValues(char* data, size_t size, KvTree& tree), ReadKeyValuesFile(const std::wstring& path, std::string& buffer, KvTree& tree);
+bool IsAsciiDigits(std::string_view text), KvKeyEquals(std::string_view a, std::string_view b), GetFileStamp(const std::wstring& path, FileStamp& stamp);
+void ReadSteamLibraries(const std::wstring& steamPath, std::vector<SteamLibrary>& libraries);
+void ListSteamManifests(const std::wstring& steamappsPath, std::vector<std::wstring>& names);
+void ResolveSteamManifest(const std::wstring& steamappsPath, const std::wstring& manifestName, const std::wstring& appInfoPath, SteamManifestResult& result);
+bool ParseSteamManifest(const std::wstring& steamappsPath, const std::wstring& manifestPath, const std::wstring& appInfoPath, Game& game);
+const SteamLaunchOption* PickSteamLaunchOption(const SteamAppInfo& info);
+UninstallEntry MakeUninstallEntry(const UninstallView& view, const RegistrySubkey& subkey);
+void ReadUninstallEntry(UninstallEntry& entry), ResolveUninstallEntry(UninstallEntry& entry);
+void UpdateSteamManifest(const std::wstring& manifestPath, const std::wstring& appInfoPath, std::vector<LibraryChange>& changes);
+void UpdateUninstallView(const UninstallView& view, std::vector<LibraryChange>& changes);
+void UpdateLibrarySource(const std::wstring& key, bool present, const FileStamp& stamp, Game game, std::vector<LibraryChange>& changes);
+bool IsGameCandidate(const UninstallEntry& entry);
+std::wstring FoldAscii(std::wstring_view text);
+std::wstring NormalizePathKey(std::wstring_view path);
+bool SplitRegistryPath(const std::wstring& key, HKEY& root, std::wstring& subPath);
+std::wstring SnapshotKeyPath(std::wstring_view key);
+void StreamKeyValues(std::string_view data, std::string_view query, const std::function<void(std::string_view, std::string_view, std::string_view)>& onValue);
+void ListSteamUsers(const std::wstring& steamPath, std::vector<std::wstring>& userDirs);
+void ReadSteamPlaytime(const std::vector<std::wstring>& userDirs, std::unordered_map<uint64_t, SteamPlaytime>& playtime);
+void ReadSteamShortcuts(const std::wstring& userDir, std::vector<Game>& games);
+bool ReadEpicManifest(const std::wstring& path, Game& game), ParseEpicManifest(std::string_view data, EpicManifest& manifest);
+bool ReadGalaxyInstalls(const std::wstring& dbPath, std::vector<GogInstall>& installs), ResolveGogInstall(const GogInstall& install, Game& game);
+bool ReadGogInfo(const std::wstring& path, const std::wstring& folder, Game& game);
+void ReadBattleNetProducts(const uint8_t* data, size_t size, std::vector<BattleNetProduct>& products);
+bool IsClaimedInstall(std::wstring_view path);
+void FindRomGames(ProviderRun& run), ReadRomSystems(const std::wstring& path, std::vector<RomSystem>& systems), ListRomFiles(const RomSystem& system, size_t index, std::vector<RomFile>& files);
+void IdentifyRom(RomFile& file, const RomDat& dat, RomScanStats& stats), ReadRomSheet(std::string_view text, std::wstring_view extension, std::vector<std::wstring>& names);
+std::wstring RomAppId(const RomFile& file);
+bool ReadDiscInfo(const std::wstring& path, std::wstring_view extension, DiscInfo& info, uint64_t& bytesRead), ReadGameCubeHeader(const uint8_t* header, size_t size, DiscInfo& info);
+bool ReadPlayStationSerial(DiscImage& image, DiscInfo& info);
+std::string NormalizeSerial(std::string_view serial);
+void FindPlaylistGames(ProviderRun& run), ReadPlaylistSources(const std::wstring& path, std::vector<PlaylistSource>& sources);
+void ReadRetroArchPlaylist(const PlaylistSource& source, const std::atomic<bool>& cancelled, std::vector<Game>& games);
+void ReadGamelist(const PlaylistSource& source, const std::atomic<bool>& cancelled, std::vector<Game>& games);
+bool MakePlaylistGame(const PlaylistSource& source, std::wstring_view name, const std::wstring& rom, const std::wstring& core, Game& game);
+std::wstring ResolveListPath(std::wstring_view base, std::wstring_view path);
+uint64_t ParseGamelistTime(std::string_view text);
+void ReadFieldLines(const std::wstring& path, const std::function<void(const std::vector<std::wstring_view>&)>& onLine);
+bool ReadZipMembers(const uint8_t* data, size_t size, std::vector<ArchiveMember>& members), Read7zMembers(const uint8_t* data, size_t size, std::vector<ArchiveMember>& members);
+bool HashFileCrc32(const std::wstring& path, uint32_t& crc, uint64_t& bytes);
+void StreamXmlTags(std::string_view xml, const std::function<void(std::string_view, std::string_view, std::string_view)>& onTag);
+std::string_view XmlAttribute(std::string_view attributes, std::string_view name);
+std::wstring XmlText(std::string_view text);
+void MergeDuplicateGames(std::vector<Game>& games), MergeGameRecord(Game& kept, Game&& other);
+bool SharesLaunch(const Game& a, const Game& b);
+std::wstring GameKey(const Game& game);
+int RecordRichness(const Game& game);
+bool StreamJsonObject(std::string_view data, const std::function<void(std::string_view, std::string_view)>& onMember);
+bool StreamJsonArray(std::string_view data, const std::function<void(std::string_view)>& onElement);
+size_t SkipJsonValue(std::string_view data, size_t i);
+std::wstring JsonToWide(std::string_view value);
+uint32_t Crc32(uint32_t crc, const void* data, size_t size);
+void LoadExclusions(const std::wstring& path);
+bool GlobMatch(std::wstring_view pattern, std::wstring_view text);
+std::string WideToUtf8(std::wstring_view text);
+std::wstring MatchKey(std::wstring_view text), Utf8ToWide(std::string_view text), JsonEscape(const std::wstring& text), GameToJson(const Game& game);
+uint64_t ParseUint(std::string_view text);
+int ScoreExecutable(std::wstring_view fileName, std::wstring_view gameName, int depth, uint64_t size), ScorePeInfo(const PeInfo& info, std::wstring_view gameName);
+bool ReadPeInfo(const std::wstring& path, PeInfo& info), ParsePeHeaders(const uint8_t* data, size_t size, PeInfo& info);
+// Library sources, merged in this order. Each runs on a thread of its own, so one stuck on a slow or offline drive never holds
+// up the others, and startup waits at most budgetMs for it; one that overruns joins the library later (see FinishProviderScan).
+// Uninstall entries give way to folders the launcher providers resolved exactly.
+const GameProvider kGameProviders[] = {
+    {L"Steam", FindSteamGames, 4000, false},
+    {L"Epic", FindEpicGames, 2000, false},
+    {L"GOG", FindGogGames, 2000, false},
+    {L"Battle.net", FindBattleNetGames, 2000, false},
+    {L"Uninstall", FindRegistryGames, 4000, true},
+    {L"ROMs", FindRomGames, 4000, false},
+    {L"Playlists", FindPlaylistGames, 2000, false},
+};
+const size_t kGameProviderCount = sizeof(kGameProviders) / sizeof(kGameProviders[0]);
 
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nCmdShow) {
+    // --registry-snapshot=<file.reg> scans against an exported registry instead of this PC's, e.g. to reproduce a user's library.
+    int argc = 0;
+    wchar_t** argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    for (int i = 1; argv && i < argc; i++) if (wcsncmp(argv[i], L"--registry-snapshot=", 20) == 0) g_registry.LoadSnapshot(argv[i] + 20);
+    LocalFree(argv);
     ScanForGames();
     WNDCLASSEXW wcex = {};
     wcex.cbSize = sizeof(WNDCLASSEXW);
@@ -56,6 +467,8 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
     ShowWindow(g_hWnd, SW_HIDE);
     UpdateWindow(g_hWnd);
     std::thread(ControllerInputThread).detach();
+    // Late providers and, from here on, installs and uninstalls arrive as incremental updates.
+    std::thread(WatchLibrary).detach();
     CreateCoreWebView2EnvironmentWithOptions(nullptr, nullptr, nullptr,
         Microsoft::WRL::Callback<ICoreWebView2CreateCoreWebView2EnvironmentCompletedHandler>(
             [](HRESULT result, ICoreWebView2Environment* env) -> HRESULT {
@@ -74,12 +487,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
                         g_webview->add_NavigationCompleted(Microsoft::WRL::Callback<ICoreWebView2NavigationCompletedEventHandler>(
                             [](ICoreWebView2* webview, ICoreWebView2NavigationCompletedEventArgs* args) -> HRESULT {
                                 std::wstring json = L"[";
-                                for (const auto& game : g_gameLibrary) {
-                                    std::wstring safe_path = game.path;
-                                    std::wregex backslash(L"\\\\");
-                                    safe_path = std::regex_replace(safe_path, backslash, L"\\\\");
-                                    json += L"{\"name\":\"" + game.name + L"\",\"path\":\"" + safe_path + L"\",\"appId\":\"" + game.appId + L"\"},";
-                                }
+                                for (const auto& game : g_gameLibrary) json += GameToJson(game) + L",";
                                 if (!g_gameLibrary.empty()) json.pop_back();
                                 json += L"]";
                                 webview->PostWebMessageAsJson(json.c_str());
@@ -101,9 +509,10 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 }
 LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) {
     switch (message) {
+    case WM_APP_LIBRARY_CHANGED: ApplyLibraryChanges(); break;
     case WM_APP_TRAY_MSG: if (lParam == WM_LBUTTONUP) ToggleFrontendVisibility(); else if (lParam == WM_RBUTTONUP) ShowContextMenu(hWnd); break;
     case WM_COMMAND: switch (LOWORD(wParam)) { case ID_MENU_SHOW: ToggleFrontendVisibility(); break; case ID_MENU_CONFIG: CreateGuidesWindow(GetModuleHandle(NULL)); break; case ID_MENU_EXIT: g_isAppRunning = false; DestroyWindow(hWnd); break; } break;
-    case WM_DESTROY: PostQuitMessage(0); break;
+    case WM_DESTROY: CancelProviderScan(); PostQuitMessage(0); break;
     default: return DefWindowProcW(hWnd, message, wParam, lParam);
     }
     return 0;
@@ -130,13 +539,2877 @@ void ControllerInputThread() {
         std::this_thread::sleep_for(std::chrono::milliseconds(16));
     }
 }
-void ScanForGames() { FindSteamGames(); FindRegistryGames(); }
-std::wstring GetSteamInstallPath() { HKEY hKey; if (RegOpenKeyExW(HKEY_LOCAL_MACHINE, L"SOFTWARE\\Valve\\Steam", 0, KEY_READ | KEY_WOW64_32KEY, &hKey) == ERROR_SUCCESS) { wchar_t buffer[MAX_PATH]; DWORD bufferSize = sizeof(buffer); if (RegQueryValueExW(hKey, L"InstallPath", nullptr, nullptr, (LPBYTE)buffer, &bufferSize) == ERROR_SUCCESS) { RegCloseKey(hKey); return std::wstring(buffer); } RegCloseKey(hKey); } return L""; }
-void FindSteamGames() { std::wstring steamPath = GetSteamInstallPath(); if (steamPath.empty()) return; std::vector<std::wstring> libraryPaths; libraryPaths.push_back(steamPath); std::wifstream libraryFile(steamPath + L"\\steamapps\\libraryfolders.vdf"); if (libraryFile.is_open()) { std::wstringstream wss; wss << libraryFile.rdbuf(); std::wstring wfileContents = wss.str(); std::wregex pathRegex(L"\"path\"\\s+\"(.+?)\""); auto matches_begin = std::wsregex_iterator(wfileContents.begin(), wfileContents.end(), pathRegex); for (auto i = matches_begin; i != std::wsregex_iterator(); ++i) { std::wstring libPath = (*i)[1].str(); libPath = std::regex_replace(libPath, std::wregex(L"\\\\\\\\"), L"\\"); libraryPaths.push_back(libPath); } } for (const auto& libPath : libraryPaths) { std::wstring steamappsPath = libPath + L"\\steamapps"; if (!std::filesystem::exists(steamappsPath)) continue; for (const auto& entry : std::filesystem::directory_iterator(steamappsPath)) { if (entry.path().filename().wstring().rfind(L"appmanifest_", 0) == 0) { std::wifstream manifestFile(entry.path()); if(manifestFile.is_open()) { std::wstringstream wss; wss << manifestFile.rdbuf(); std::wstring wManifestContents = wss.str(); std::wsmatch appid_match, name_match, installdir_match; if (std::regex_search(wManifestContents, appid_match, std::wregex(L"\"appid\"\\s+\"(\\d+)\"")) && std::regex_search(wManifestContents, name_match, std::wregex(L"\"name\"\\s+\"(.+?)\"")) && std::regex_search(wManifestContents, installdir_match, std::wregex(L"\"installdir\"\\s+\"(.+?)\""))) { std::wstring gameDir = steamappsPath + L"\\common\\" + installdir_match[1].str(); std::wstring exePath = FindExecutableInDir(gameDir); if (!exePath.empty()) { g_gameLibrary.push_back({name_match[1].str(), exePath, appid_match[1].str()}); } } } } } } }
-void FindRegistryGames() { const wchar_t* regKey = L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Uninstall"; HKEY hKey; if (RegOpenKeyExW(HKEY_LOCAL_MACHINE, regKey, 0, KEY_READ | KEY_WOW64_64KEY, &hKey) != ERROR_SUCCESS) return; wchar_t subKeyName[255]; DWORD subKeySize = 255; for (DWORD i = 0; RegEnumKeyExW(hKey, i, subKeyName, &subKeySize, NULL, NULL, NULL, NULL) == ERROR_SUCCESS; i++, subKeySize = 255) { HKEY hSubKey; if (RegOpenKeyExW(hKey, subKeyName, 0, KEY_READ, &hSubKey) == ERROR_SUCCESS) { wchar_t displayName[255] = {0}, installLocation[MAX_PATH] = {0}, publisher[255] = {0}; DWORD nameSize = sizeof(displayName), locSize = sizeof(installLocation), pubSize = sizeof(publisher); if (RegQueryValueExW(hSubKey, L"DisplayName", NULL, NULL, (LPBYTE)displayName, &nameSize) == ERROR_SUCCESS && RegQueryValueExW(hSubKey, L"InstallLocation", NULL, NULL, (LPBYTE)installLocation, &locSize) == ERROR_SUCCESS) { RegQueryValueExW(hSubKey, L"Publisher", NULL, NULL, (LPBYTE)publisher, &pubSize); std::wstring publisherStr(publisher), nameStr(displayName); if (!nameStr.empty() && locSize > 0 && publisherStr.find(L"Microsoft") == std::wstring::npos && nameStr.find(L"Update") == std::wstring::npos) { std::wstring exePath = FindExecutableInDir(installLocation); if(!exePath.empty()) { g_gameLibrary.push_back({nameStr, exePath, L""}); } } } RegCloseKey(hSubKey); } } RegCloseKey(hKey); }
-std::wstring FindExecutableInDir(const std::wstring& dirPath) { if (!std::filesystem::exists(dirPath)) return L""; for (const auto& entry : std::filesystem::recursive_directory_iterator(dirPath)) { if (entry.is_regular_file() && entry.path().extension() == L".exe") { return entry.path().wstring(); } } return L""; }
+void ScanForGames() {
+    // A snapshot describes some other machine, so its results must not replace this one's cache.
+    std::wstring cachePath = GetExecutablePath() + L"\\library.cache";
+    LoadExclusions(GetExecutablePath() + L"\\scan-exclusions.txt");
+    g_scanCache.pickSignature = Crc32(g_exclusions.signature, &kExeScoringVersion, sizeof(kExeScoringVersion));
+    if (!g_registry.fromSnapshot) g_scanCache.Load(cachePath);
+    auto scan = std::make_shared<ProviderScan>();
+    scan->runs = std::vector<ProviderRun>(kGameProviderCount);
+    g_providerScan = scan;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kGameProviderCount; i++) std::thread([scan, i] { RunProvider(*scan, i); }).detach();
+    bool late = false;
+    {
+        std::unique_lock<std::mutex> guard(scan->lock);
+        for (size_t i = 0; i < kGameProviderCount; i++) {
+            ProviderRun& run = scan->runs[i];
+            scan->finished.wait_until(guard, start + std::chrono::milliseconds(kGameProviders[i].budgetMs), [&run] { return run.done; });
+            run.late = !run.done;
+            late |= run.late;
+        }
+        std::vector<LibraryChange> unused;
+        MergeProviderRuns(*scan, false, g_gameLibrary, unused);
+    }
+    MergeDuplicateGames(g_gameLibrary);
+    // The cache stays mapped while a late provider may still read it; FinishProviderScan saves it instead.
+    if (!g_registry.fromSnapshot && !late) g_scanCache.Save(cachePath);
+}
+// Times the provider and reports it through OutputDebugString (DebugView shows it), whether or not startup still waits for it.
+void RunProvider(ProviderScan& scan, size_t index) {
+    ProviderRun& run = scan.runs[index];
+    auto start = std::chrono::steady_clock::now();
+    kGameProviders[index].find(run);
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    wchar_t line[160];
+    swprintf(line, 160, L"WinDeck Nexus: %ls provider took %.1f ms, %zu games%ls\n", kGameProviders[index].name, milliseconds, run.games.size(),
+        run.cancelled ? L" (cancelled)" : L"");
+    OutputDebugStringW(line);
+    std::lock_guard<std::mutex> guard(scan.lock);
+    run.done = true;
+    scan.finished.notify_all();
+}
+// Adds the runs that were (late == false) or were not (late == true) done when ScanForGames stopped waiting, in provider
+// order. Claims go first so that every yielding provider's games can be checked against all of them. Late games are added
+// to `games` too, and a late claim also takes back any game a yielding provider already showed from inside that folder.
+void MergeProviderRuns(ProviderScan& scan, bool late, std::vector<Game>& games, std::vector<LibraryChange>& changes) {
+    bool claimed = false;
+    for (auto& run : scan.runs) if (run.late == late && !run.cancelled) for (const auto& folder : run.claims) claimed |= g_claimedInstalls.insert(NormalizePathKey(folder)).second;
+    if (late && claimed) {
+        for (size_t i = 0; i < kGameProviderCount; i++) {
+            if (!kGameProviders[i].yieldsToClaims || scan.runs[i].late) continue;
+            for (const auto& source : scan.runs[i].sources) {
+                auto known = g_librarySources.find(source.first);
+                if (known != g_librarySources.end() && !known->second.game.path.empty() && IsClaimedInstall(known->second.game.path))
+                    UpdateLibrarySource(source.first, true, known->second.stamp, Game(), changes);
+            }
+        }
+    }
+    for (size_t i = 0; i < kGameProviderCount; i++) {
+        ProviderRun& run = scan.runs[i];
+        if (run.late != late || run.cancelled) continue;
+        bool yields = kGameProviders[i].yieldsToClaims;
+        for (const auto& game : run.games) if (!yields || !IsClaimedInstall(game.path)) games.push_back(game);
+        for (auto& source : run.sources) {
+            if (yields && !source.second.game.path.empty() && IsClaimedInstall(source.second.game.path)) source.second.game = Game();
+            g_librarySources[source.first] = source.second;
+        }
+    }
+}
+// Runs first on the watcher thread: waits for the providers that missed their startup budget, hands their games to the
+// window as incremental changes, and saves the cache once nothing reads the old one any more.
+void FinishProviderScan() {
+    std::shared_ptr<ProviderScan> scan = g_providerScan;
+    if (!scan) return;
+    std::vector<Game> games;
+    std::vector<LibraryChange> changes;
+    {
+        std::unique_lock<std::mutex> guard(scan->lock);
+        auto allDone = [&scan] { return std::all_of(scan->runs.begin(), scan->runs.end(), [](const ProviderRun& run) { return run.done; }); };
+        if (std::none_of(scan->runs.begin(), scan->runs.end(), [](const ProviderRun& run) { return run.late; })) return;
+        while (!allDone()) if (!g_isAppRunning) return; else scan->finished.wait_for(guard, std::chrono::seconds(1));
+        MergeProviderRuns(*scan, true, games, changes);
+    }
+    for (auto& game : games) changes.push_back({Game(), false, std::move(game)});
+    if (!g_registry.fromSnapshot) g_scanCache.Save(GetExecutablePath() + L"\\library.cache");
+    if (changes.empty()) return;
+    std::lock_guard<std::mutex> guard(g_libraryChangesLock);
+    g_libraryChanges.insert(g_libraryChanges.end(), std::make_move_iterator(changes.begin()), std::make_move_iterator(changes.end()));
+    PostMessageW(g_hWnd, WM_APP_LIBRARY_CHANGED, 0, 0);
+}
+// Providers check their flag between units of work, so the ones still running stop soon after the window goes away.
+void CancelProviderScan() {
+    if (g_providerScan) for (auto& run : g_providerScan->runs) run.cancelled = true;
+}
+std::wstring GetSteamInstallPath() { return g_registry.ReadString(L"HKEY_LOCAL_MACHINE\\SOFTWARE\\Valve\\Steam", L"InstallPath", KEY_WOW64_32KEY); }
+void FindSteamGames(ProviderRun& run) {
+    std::wstring steamPath = GetSteamInstallPath();
+    if (steamPath.empty()) return;
+    std::vector<SteamLibrary> libraries;
+    ReadSteamLibraries(steamPath, libraries);
+    std::wstring libraryFoldersPath = steamPath + L"\\steamapps\\libraryfolders.vdf";
+    FileStamp foldersStamp;
+    GetFileStamp(libraryFoldersPath, foldersStamp);
+    // Folder listings and manifests fan out over the worker pool. Every result has a fixed slot, so merging the slots in order
+    // below yields exactly the library a sequential scan would.
+    std::vector<std::vector<std::wstring>> manifests(libraries.size());
+    std::vector<std::vector<SteamManifestResult>> results(libraries.size());
+    std::vector<char> mapped(libraries.size());
+    g_workerPool.ParallelFor(libraries.size(), [&](size_t i) {
+        if (run.cancelled) return;
+        std::wstring steamappsPath = libraries[i].path + L"\\steamapps";
+        FileStamp steamappsStamp;
+        if (!GetFileStamp(steamappsPath, steamappsStamp)) return;
+        // The apps map lets us open each manifest directly. It is stale if the folder changed after Steam last wrote it.
+        mapped[i] = libraries[i].hasAppMap && steamappsStamp.mtime <= foldersStamp.mtime;
+        if (mapped[i]) for (const auto& appId : libraries[i].appIds) manifests[i].push_back(L"appmanifest_" + appId + L".acf");
+        else ListSteamManifests(steamappsPath, manifests[i]);
+    });
+    // Only manifests that miss the cache decode their app from appinfo.vdf, so a warm scan never opens it (see SteamAppInfoIndex).
+    std::wstring appInfoPath = steamPath + L"\\appcache\\appinfo.vdf";
+    std::vector<std::pair<size_t, size_t>> jobs;
+    auto resolve = [&]() {
+        g_workerPool.ParallelFor(jobs.size(), [&](size_t j) { if (!run.cancelled) ResolveSteamManifest(libraries[jobs[j].first].path + L"\\steamapps", manifests[jobs[j].first][jobs[j].second], appInfoPath, results[jobs[j].first][jobs[j].second]); });
+        jobs.clear();
+    };
+    for (size_t i = 0; i < libraries.size(); i++) {
+        results[i].resize(manifests[i].size());
+        for (size_t m = 0; m < manifests[i].size(); m++) jobs.push_back({i, m});
+    }
+    resolve();
+    // A mapped manifest that is gone means the map is out of date: pick up anything installed since by listing the folder.
+    for (size_t i = 0; i < libraries.size(); i++) {
+        if (!mapped[i] || std::all_of(results[i].begin(), results[i].end(), [](const SteamManifestResult& r) { return r.read; })) continue;
+        std::vector<std::wstring> listed;
+        ListSteamManifests(libraries[i].path + L"\\steamapps", listed);
+        size_t known = manifests[i].size();
+        for (const auto& manifest : listed) if (std::find(manifests[i].begin(), manifests[i].begin() + known, manifest) == manifests[i].begin() + known) manifests[i].push_back(manifest);
+        results[i].resize(manifests[i].size());
+        for (size_t m = known; m < manifests[i].size(); m++) jobs.push_back({i, m});
+    }
+    resolve();
+    // Play history changes every session, so it is read fresh from localconfig.vdf rather than cached with the manifest.
+    std::vector<std::wstring> userDirs;
+    ListSteamUsers(steamPath, userDirs);
+    std::unordered_map<uint64_t, SteamPlaytime> playtime;
+    ReadSteamPlaytime(userDirs, playtime);
+    for (auto& library : results) for (auto& result : library) {
+        if (!result.read) continue;
+        g_scanCache.Store(result.manifestPath, result.stamp, result.game);
+        run.sources.push_back({result.manifestPath, {result.stamp, result.game}});
+        if (result.game.path.empty()) continue;
+        auto played = playtime.find(wcstoull(result.game.appId.c_str(), nullptr, 10));
+        if (played != playtime.end()) { result.game.lastPlayed = played->second.lastPlayed; result.game.playtimeMinutes = played->second.minutes; }
+        run.games.push_back(result.game);
+    }
+    // Non-Steam shortcuts (Steam ROM Manager entries, apps added by hand) carry their exe, so they cost one file read per account.
+    std::vector<std::vector<Game>> shortcuts(userDirs.size());
+    g_workerPool.ParallelFor(userDirs.size(), [&](size_t i) { ReadSteamShortcuts(userDirs[i], shortcuts[i]); });
+    for (const auto& user : shortcuts) run.games.insert(run.games.end(), user.begin(), user.end());
+}
+// The Steam folder itself plus every library listed in libraryfolders.vdf, each with its apps map when the file has one.
+void ReadSteamLibraries(const std::wstring& steamPath, std::vector<SteamLibrary>& libraries) {
+    libraries.push_back({steamPath});
+    std::wstring libraryFoldersPath = steamPath + L"\\steamapps\\libraryfolders.vdf";
+    std::string libraryData; KvTree libraryTree;
+    if (ReadKeyValuesFile(libraryFoldersPath, libraryData, libraryTree)) {
+        // Current format nests { "path" ... "apps" { "<appid>" "<size>" } } blocks; the legacy format maps "1", "2", ... straight to a path.
+        int root = libraryTree.Find(0, "libraryfolders");
+        for (int i = root != -1 ? libraryTree.nodes[root].firstChild : -1; i != -1; i = libraryTree.nodes[i].nextSibling) {
+            const KvNode& folder = libraryTree.nodes[i];
+            std::string_view path = folder.isBlock ? libraryTree.Get(i, "path") : (IsAsciiDigits(folder.key) ? folder.value : std::string_view());
+            if (path.empty()) continue;
+            std::wstring libPath = Utf8ToWide(path);
+            SteamLibrary* library = nullptr;
+            for (auto& existing : libraries) if (_wcsicmp(existing.path.c_str(), libPath.c_str()) == 0) library = &existing;
+            if (!library) { libraries.push_back({libPath}); library = &libraries.back(); }
+            int apps = folder.isBlock ? libraryTree.Find(i, "apps") : -1;
+            if (apps == -1 || !libraryTree.nodes[apps].isBlock) continue;
+            library->hasAppMap = true;
+            for (int app = libraryTree.nodes[apps].firstChild; app != -1; app = libraryTree.nodes[app].nextSibling)
+                if (IsAsciiDigits(libraryTree.nodes[app].key)) library->appIds.push_back(Utf8ToWide(libraryTree.nodes[app].key));
+        }
+    }
+}
+void ListSteamManifests(const std::wstring& steamappsPath, std::vector<std::wstring>& names) {
+    DirectoryReader reader;
+    DirEntry entry;
+    if (!reader.Open(steamappsPath)) return;
+    while (reader.Next(entry)) if (!entry.isDirectory && wcsncmp(entry.name, L"appmanifest_", 12) == 0) names.push_back(entry.name);
+}
+void ResolveSteamManifest(const std::wstring& steamappsPath, const std::wstring& manifestName, const std::wstring& appInfoPath, SteamManifestResult& result) {
+    result.manifestPath = steamappsPath + L"\\" + manifestName;
+    result.read = GetFileStamp(result.manifestPath, result.stamp)
+        && (g_scanCache.Lookup(result.manifestPath, result.stamp, result.game) || ParseSteamManifest(steamappsPath, result.manifestPath, appInfoPath, result.game));
+}
+bool ParseSteamManifest(const std::wstring& steamappsPath, const std::wstring& manifestPath, const std::wstring& appInfoPath, Game& game) {
+    std::string manifestData; KvTree manifest;
+    if (!ReadKeyValuesFile(manifestPath, manifestData, manifest)) return false;
+    int appState = manifest.Find(0, "AppState");
+    std::string_view appId = manifest.Get(appState, "appid"), name = manifest.Get(appState, "name"), installDir = manifest.Get(appState, "installdir");
+    if (!IsAsciiDigits(appId) || name.empty() || installDir.empty()) return true;
+    // Downloading, updating and uninstalling apps are settled from the manifest alone, before anything touches the install folder.
+    uint32_t stateFlags = (uint32_t)ParseUint(manifest.Get(appState, "StateFlags"));
+    if (!(stateFlags & kAppStateFullyInstalled) || (stateFlags & kAppStateBusyMask)) return true;
+    std::wstring installPath = steamappsPath + L"\\common\\" + Utf8ToWide(installDir), exePath, arguments, workingDir;
+    // Launch paths are relative to the install folder, written with either slash and sometimes a leading ".\".
+    auto inInstall = [&installPath](std::string_view relative) {
+        std::wstring path = Utf8ToWide(relative);
+        std::replace(path.begin(), path.end(), L'/', L'\\');
+        size_t skip = path.rfind(L".\\", 0) == 0 ? 2 : 0;
+        while (skip < path.size() && path[skip] == L'\\') skip++;
+        return installPath + L"\\" + path.substr(skip);
+    };
+    SteamAppInfo info;
+    std::shared_ptr<const SteamAppInfoFile> appInfo = g_steamAppInfo.Get(appInfoPath); // Keeps the views in info mapped
+    if (appInfo->Find((uint32_t)ParseUint(appId), info)) {
+        // Tools, soundtracks, redistributables and the like install like games but are nothing to launch from the frontend.
+        for (const char* type : { "tool", "music", "config", "video", "dlc" }) if (KvKeyEquals(info.type, type)) return true;
+        if (!info.name.empty()) name = info.name;
+        if (const SteamLaunchOption* option = PickSteamLaunchOption(info)) {
+            std::wstring candidate = inInstall(option->executable);
+            DWORD attributes = GetFileAttributesW(candidate.c_str());
+            if (attributes != INVALID_FILE_ATTRIBUTES && !(attributes & FILE_ATTRIBUTE_DIRECTORY)) {
+                exePath = candidate;
+                arguments = Utf8ToWide(option->arguments);
+                if (!option->workingDir.empty()) workingDir = inInstall(option->workingDir);
+            }
+        }
+    }
+    // Apps Steam has not cached metadata for, or whose launch entry points at a file that is not there, fall back to a search.
+    if (exePath.empty()) exePath = ResolveExecutable(installPath, Utf8ToWide(name));
+    if (exePath.empty()) return true;
+    game = {Utf8ToWide(name), exePath, Utf8ToWide(appId), ParseUint(manifest.Get(appState, "SizeOnDisk")), ParseUint(manifest.Get(appState, "LastUpdated")),
+        ParseUint(manifest.Get(appState, "BytesToDownload")), (uint32_t)ParseUint(manifest.Get(appState, "buildid")), stateFlags};
+    game.source = L"steam";
+    game.launchOptions = arguments;
+    game.startDir = workingDir;
+    return true;
+}
+bool GetFileStamp(const std::wstring& path, FileStamp& stamp) {
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &data)) return false;
+    stamp.mtime = ((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+    stamp.size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+    return true;
+}
+void FindRegistryGames(ProviderRun& run) {
+    std::vector<std::vector<RegistrySubkey>> subkeys(kUninstallViewCount);
+    g_workerPool.ParallelFor(kUninstallViewCount, [&](size_t v) { g_registry.ListSubkeys(std::wstring(kUninstallViews[v].hive) + L"\\" + kUninstallKey, subkeys[v], kUninstallViews[v].view); });
+    std::vector<UninstallEntry> entries;
+    for (size_t v = 0; v < kUninstallViewCount; v++) for (const auto& subkey : subkeys[v]) entries.push_back(MakeUninstallEntry(kUninstallViews[v], subkey));
+    g_workerPool.ParallelFor(entries.size(), [&](size_t i) {
+        UninstallEntry& entry = entries[i];
+        if (run.cancelled) { entry.stored = false; return; }
+        entry.cached = g_scanCache.Lookup(entry.cacheKey, entry.stamp, entry.game);
+        if (!entry.cached) ReadUninstallEntry(entry);
+    });
+    // An install registered in several views is resolved once, for its first entry. The others are left out of the cache so
+    // they get another chance should that entry go away.
+    std::unordered_set<std::wstring> locations;
+    std::vector<size_t> pending;
+    for (size_t i = 0; i < entries.size(); i++) {
+        UninstallEntry& entry = entries[i];
+        if (entry.cached || !IsGameCandidate(entry)) continue;
+        if (locations.insert(NormalizePathKey(entry.location)).second) pending.push_back(i);
+        else entry.stored = false;
+    }
+    g_workerPool.ParallelFor(pending.size(), [&](size_t j) { if (!run.cancelled) ResolveUninstallEntry(entries[pending[j]]); else entries[pending[j]].stored = false; });
+    std::unordered_set<std::wstring> games;
+    for (const auto& entry : entries) {
+        if (entry.stored) g_scanCache.Store(entry.cacheKey, entry.stamp, entry.game);
+        bool added = !entry.game.path.empty() && games.insert(NormalizePathKey(entry.game.path)).second;
+        if (added) run.games.push_back(entry.game);
+        run.sources.push_back({entry.cacheKey, {entry.stamp, added ? entry.game : Game()}});
+    }
+}
+// The subkey's last-write time comes back with the enumeration, so a cache hit never opens the key.
+UninstallEntry MakeUninstallEntry(const UninstallView& view, const RegistrySubkey& subkey) {
+    UninstallEntry entry;
+    entry.cacheKey = std::wstring(view.cachePrefix) + L"\\" + kUninstallKey + L"\\" + subkey.name;
+    entry.keyPath = std::wstring(view.hive) + L"\\" + kUninstallKey + L"\\" + subkey.name;
+    entry.view = view.view;
+    entry.stamp = { subkey.lastWrite, 0 };
+    return entry;
+}
+void ReadUninstallEntry(UninstallEntry& entry) {
+    std::vector<RegistryValue> values;
+    if (!g_registry.ReadValues(entry.keyPath, { L"DisplayName", L"InstallLocation", L"Publisher", L"DisplayIcon", L"EstimatedSize", L"SystemComponent", L"ParentKeyName", L"ReleaseType" }, values, entry.view)) return;
+    entry.name = values[0].text; entry.location = values[1].text; entry.publisher = values[2].text; entry.icon = values[3].text;
+    entry.estimatedSizeKb = values[4].number;
+    entry.systemComponent = values[5].number != 0;
+    // Updates and hotfixes name the product they patch, or say what they are.
+    entry.isPatch = !values[6].text.empty() || !values[7].text.empty();
+    // Some installers write the folder quoted or with a trailing separator.
+    std::wstring_view location = entry.location;
+    while (!location.empty() && (iswspace(location.front()) || location.front() == L'"')) location.remove_prefix(1);
+    while (!location.empty() && (iswspace(location.back()) || location.back() == L'"')) location.remove_suffix(1);
+    entry.location = location;
+}
+// Weights are additive. Where games live (store library folders) and who publishes them push an entry up; drivers, runtimes,
+// SDKs, hardware vendors and everyday apps push it down. An entry needs positive evidence to be walked: an unknown publisher in
+// an ordinary folder scores 0 and is dropped, and the generic roots per-user and desktop apps install to count against it, so
+// only a large install or a game-specific hit gets one of those through.
+const int kRuleReject = -1000, kGameScoreThreshold = 1;
+const UninstallRule kUninstallRules[] = {
+    // Steam writes "Steam App <id>" entries for its games; FindSteamGames already has them, with better metadata.
+    { kFieldKey, L"steam app ", kRuleReject },
+    { kFieldLocation, L"\\steamapps\\common\\", 60 }, { kFieldLocation, L"\\epic games\\", 50 }, { kFieldLocation, L"\\gog galaxy\\games\\", 60 },
+    { kFieldLocation, L"\\gog games\\", 60 }, { kFieldLocation, L"\\ubisoft game launcher\\games\\", 60 }, { kFieldLocation, L"\\origin games\\", 60 },
+    { kFieldLocation, L"\\ea games\\", 50 }, { kFieldLocation, L"\\xboxgames\\", 50 }, { kFieldLocation, L"\\riot games\\", 40 },
+    { kFieldLocation, L"\\itch\\apps\\", 60 }, { kFieldLocation, L"\\amazon games\\library\\", 60 }, { kFieldLocation, L"\\games\\", 30 },
+    { kFieldLocation, L"\\windows\\", kRuleReject }, { kFieldLocation, L"\\common files\\", kRuleReject }, { kFieldLocation, L"\\nvidia corporation\\", kRuleReject },
+    { kFieldLocation, L"\\microsoft", -80 }, { kFieldLocation, L"\\appdata\\", -40 }, { kFieldLocation, L"\\program files\\", -15 },
+    { kFieldLocation, L"\\program files (x86)\\", -15 },
+    { kFieldPublisher, L"valve", 30 }, { kFieldPublisher, L"gog", 20 }, { kFieldPublisher, L"ubisoft", 30 }, { kFieldPublisher, L"electronic arts", 30 },
+    { kFieldPublisher, L"bethesda", 40 }, { kFieldPublisher, L"square enix", 40 }, { kFieldPublisher, L"bandai namco", 40 }, { kFieldPublisher, L"capcom", 40 },
+    { kFieldPublisher, L"sega", 30 }, { kFieldPublisher, L"devolver", 40 }, { kFieldPublisher, L"paradox interactive", 40 }, { kFieldPublisher, L"cd projekt", 40 },
+    { kFieldPublisher, L"rockstar games", 40 }, { kFieldPublisher, L"activision", 40 }, { kFieldPublisher, L"blizzard", 30 }, { kFieldPublisher, L"riot games", 40 },
+    { kFieldPublisher, L"thq nordic", 40 }, { kFieldPublisher, L"team17", 40 }, { kFieldPublisher, L"mojang", 40 }, { kFieldPublisher, L"games", 20 },
+    { kFieldPublisher, L"microsoft", -80 }, { kFieldPublisher, L"nvidia", -80 }, { kFieldPublisher, L"intel", -80 }, { kFieldPublisher, L"advanced micro devices", -80 },
+    { kFieldPublisher, L"realtek", -80 }, { kFieldPublisher, L"logitech", -60 }, { kFieldPublisher, L"corsair", -60 }, { kFieldPublisher, L"razer", -40 },
+    { kFieldPublisher, L"google", -60 }, { kFieldPublisher, L"mozilla", -80 }, { kFieldPublisher, L"oracle", -80 }, { kFieldPublisher, L"adobe", -80 },
+    { kFieldPublisher, L"python software", -80 }, { kFieldPublisher, L"jetbrains", -80 }, { kFieldPublisher, L"docker", -80 }, { kFieldPublisher, L"autodesk", -80 },
+    { kFieldPublisher, L"apple", -60 }, { kFieldPublisher, L"zoom", -80 }, { kFieldPublisher, L"igor pavlov", -80 }, { kFieldPublisher, L"videolan", -80 },
+    { kFieldPublisher, L"discord", -80 }, { kFieldPublisher, L"spotify", -80 }, { kFieldPublisher, L"slack", -80 }, { kFieldPublisher, L"obs project", -80 },
+    { kFieldPublisher, L"git development community", -80 }, { kFieldPublisher, L"notepad++", -80 }, { kFieldPublisher, L"the document foundation", -80 }, { kFieldPublisher, L"dell", -60 }, { kFieldPublisher, L"hp inc", -60 }, { kFieldPublisher, L"lenovo", -60 },
+    { kFieldName, L"redistributable", kRuleReject }, { kFieldName, L"visual c++", kRuleReject }, { kFieldName, L"driver", -80 }, { kFieldName, L"runtime", -80 },
+    { kFieldName, L".net", -80 }, { kFieldName, L"directx", -80 }, { kFieldName, L"sdk", -60 }, { kFieldName, L"update", -60 }, { kFieldName, L"hotfix", -80 },
+    { kFieldName, L"framework", -80 }, { kFieldName, L"codec", -80 }, { kFieldName, L"plugin", -60 }, { kFieldName, L"plug-in", -60 }, { kFieldName, L"toolkit", -60 },
+    { kFieldName, L"service", -50 }, { kFieldName, L"helper", -50 }, { kFieldName, L"launcher", -40 }, { kFieldName, L"=steam", -80 }, { kFieldName, L"gog galaxy", -60 },
+    { kFieldName, L"ubisoft connect", -60 }, { kFieldName, L"=ea app", -80 }, { kFieldName, L"=battle.net", -80 },
+    // An icon taken from an installer or msiexec says nothing; one from a game engine's exe does.
+    { kFieldIcon, L"msiexec", -20 }, { kFieldIcon, L"unins", -5 }, { kFieldIcon, L"-win64-shipping.exe", 20 }, { kFieldIcon, L"unitycrashhandler", 10 },
+};
+bool IsGameCandidate(const UninstallEntry& entry) {
+    // Nothing is walked on disk until an entry clears this, so rejecting here is what keeps non-games cheap.
+    if (entry.name.empty() || entry.location.empty() || entry.systemComponent || entry.isPatch) return false;
+    static const UninstallClassifier classifier = [] {
+        UninstallClassifier compiled;
+        for (const auto& rule : kUninstallRules) {
+            bool exact = rule.text[0] == L'=';
+            compiled.patterns[rule.field].push_back({FoldAscii(rule.text + exact), rule.weight, exact});
+        }
+        return compiled;
+    }();
+    return classifier.Score(entry) >= kGameScoreThreshold;
+}
+int UninstallClassifier::Score(const UninstallEntry& entry) const {
+    std::wstring_view key = entry.keyPath;
+    key = key.substr(key.rfind(L'\\') + 1);
+    // The location gets a trailing separator so folder rules also match the folder the path ends in.
+    const std::wstring fields[kFieldCount] = { FoldAscii(key), FoldAscii(entry.name), FoldAscii(entry.publisher), FoldAscii(entry.location + L"\\"), FoldAscii(entry.icon) };
+    int score = 0;
+    for (int field = 0; field < kFieldCount; field++)
+        for (const auto& pattern : patterns[field])
+            if (pattern.exact ? fields[field] == pattern.text : fields[field].find(pattern.text) != std::wstring::npos) score += pattern.weight;
+    // EstimatedSize is in KB. Games are big; a few MB is a utility.
+    if (entry.estimatedSizeKb > (2u << 20)) score += 30;
+    else if (entry.estimatedSizeKb > (500u << 10)) score += 15;
+    else if (entry.estimatedSizeKb && entry.estimatedSizeKb < (20u << 10)) score -= 20;
+    return score;
+}
+// ASCII-only case folding: branch-free per character, so the compiler can vectorize it, and enough for the rule texts.
+std::wstring FoldAscii(std::wstring_view text) {
+    std::wstring folded(text);
+    for (auto& c : folded) c |= (wchar_t)((unsigned)(c - L'A') < 26u) << 5;
+    return folded;
+}
+void ResolveUninstallEntry(UninstallEntry& entry) {
+    std::wstring exePath = ResolveExecutable(entry.location, entry.name);
+    if (exePath.empty()) return;
+    entry.game = {entry.name, exePath, L""};
+    entry.game.source = L"registry";
+}
+// Case-folded, forward slashes turned around and trailing separators dropped: the key that tells two spellings of a path apart.
+std::wstring NormalizePathKey(std::wstring_view path) {
+    std::wstring key;
+    for (wchar_t c : path) key += c == L'/' ? L'\\' : (wchar_t)towlower(c);
+    while (key.size() > 3 && key.back() == L'\\') key.pop_back();
+    return key;
+}
+bool SplitRegistryPath(const std::wstring& key, HKEY& root, std::wstring& subPath) {
+    size_t slash = key.find(L'\\');
+    std::wstring_view head = std::wstring_view(key).substr(0, slash);
+    if (head == L"HKEY_LOCAL_MACHINE" || head == L"HKLM") root = HKEY_LOCAL_MACHINE;
+    else if (head == L"HKEY_CURRENT_USER" || head == L"HKCU") root = HKEY_CURRENT_USER;
+    else return false;
+    subPath = slash == std::wstring::npos ? L"" : key.substr(slash + 1);
+    return true;
+}
+bool Registry::ReadValues(const std::wstring& key, const std::vector<const wchar_t*>& names, std::vector<RegistryValue>& values, REGSAM view) const {
+    values.assign(names.size(), RegistryValue());
+    if (fromSnapshot) {
+        const RegistrySnapshotKey* found = FindSnapshotKey(key, view);
+        if (!found) return false;
+        for (size_t i = 0; i < names.size(); i++) {
+            auto value = found->values.find(SnapshotKeyPath(names[i]));
+            if (value != found->values.end()) values[i] = value->second;
+        }
+        return true;
+    }
+    HKEY root, handle;
+    std::wstring subPath;
+    if (!SplitRegistryPath(key, root, subPath) || RegOpenKeyExW(root, subPath.c_str(), 0, KEY_READ | view, &handle) != ERROR_SUCCESS) return false;
+    // One buffer sized for the key's largest value serves every read, so no value needs a size query first or gets cut short.
+    DWORD maxData = 0;
+    RegQueryInfoKeyW(handle, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, &maxData, nullptr, nullptr);
+    std::vector<uint8_t> data(maxData + sizeof(wchar_t));
+    for (size_t i = 0; i < names.size(); i++) {
+        DWORD type = REG_NONE, size = (DWORD)data.size() - sizeof(wchar_t);
+        LSTATUS status = RegQueryValueExW(handle, names[i], nullptr, &type, data.data(), &size);
+        if (status == ERROR_MORE_DATA) { data.resize(size + sizeof(wchar_t)); status = RegQueryValueExW(handle, names[i], nullptr, &type, data.data(), &size); }
+        if (status != ERROR_SUCCESS) continue;
+        RegistryValue& value = values[i];
+        value.type = type;
+        if (type == REG_SZ || type == REG_EXPAND_SZ) {
+            value.text.assign((const wchar_t*)data.data(), size / sizeof(wchar_t));
+            while (!value.text.empty() && value.text.back() == 0) value.text.pop_back();
+        }
+        else if (type == REG_DWORD && size >= 4) { uint32_t number; memcpy(&number, data.data(), 4); value.number = number; }
+        else if (type == REG_QWORD && size >= 8) memcpy(&value.number, data.data(), 8);
+    }
+    RegCloseKey(handle);
+    return true;
+}
+std::wstring Registry::ReadString(const std::wstring& key, const wchar_t* name, REGSAM view) const {
+    std::vector<RegistryValue> values;
+    return ReadValues(key, { name }, values, view) ? values[0].text : L"";
+}
+bool Registry::ListSubkeys(const std::wstring& key, std::vector<RegistrySubkey>& subkeys, REGSAM view) const {
+    if (fromSnapshot) {
+        const RegistrySnapshotKey* found = FindSnapshotKey(key, view);
+        if (found) for (const auto& child : found->children) subkeys.push_back({child, 0});
+        return found != nullptr;
+    }
+    HKEY root, handle;
+    std::wstring subPath;
+    if (!SplitRegistryPath(key, root, subPath) || RegOpenKeyExW(root, subPath.c_str(), 0, KEY_READ | view, &handle) != ERROR_SUCCESS) return false;
+    DWORD count = 0, maxName = 0;
+    RegQueryInfoKeyW(handle, nullptr, nullptr, nullptr, &count, &maxName, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr);
+    subkeys.reserve(subkeys.size() + count);
+    std::vector<wchar_t> name(maxName + 1);
+    DWORD nameSize = (DWORD)name.size(); FILETIME lastWrite;
+    for (DWORD i = 0; RegEnumKeyExW(handle, i, name.data(), &nameSize, nullptr, nullptr, nullptr, &lastWrite) == ERROR_SUCCESS; i++, nameSize = (DWORD)name.size())
+        subkeys.push_back({std::wstring(name.data(), nameSize), ((uint64_t)lastWrite.dwHighDateTime << 32) | lastWrite.dwLowDateTime});
+    RegCloseKey(handle);
+    return true;
+}
+// Lower-cased, with the hive spelled out, so HKLM\Software\X and HKEY_LOCAL_MACHINE\SOFTWARE\X find the same snapshot key.
+std::wstring SnapshotKeyPath(std::wstring_view key) {
+    while (!key.empty() && key.back() == L'\\') key.remove_suffix(1);
+    std::wstring path;
+    if (key.substr(0, 5) == L"HKLM\\" || key == L"HKLM") { path = L"hkey_local_machine"; key.remove_prefix(4); }
+    else if (key.substr(0, 5) == L"HKCU\\" || key == L"HKCU") { path = L"hkey_current_user"; key.remove_prefix(4); }
+    for (wchar_t c : key) path += (wchar_t)towlower(c);
+    return path;
+}
+const RegistrySnapshotKey* Registry::FindSnapshotKey(const std::wstring& key, REGSAM view) const {
+    std::wstring path = SnapshotKeyPath(key);
+    const std::wstring software = L"hkey_local_machine\\software\\";
+    // Exports from 64-bit Windows have a WOW6432Node; there, as in the live registry, the 32-bit view sees nothing else.
+    if ((view & KEY_WOW64_32KEY) && path.compare(0, software.size(), software) == 0 && snapshot.count(software + L"wow6432node"))
+        path = software + L"wow6432node\\" + path.substr(software.size());
+    auto found = snapshot.find(path);
+    return found != snapshot.end() ? &found->second : nullptr;
+}
+RegistrySnapshotKey& Registry::AddSnapshotKey(std::wstring_view path) {
+    auto inserted = snapshot.try_emplace(SnapshotKeyPath(path));
+    RegistrySnapshotKey& key = inserted.first->second;
+    size_t slash = path.rfind(L'\\');
+    if (inserted.second && slash != std::wstring_view::npos) AddSnapshotKey(path.substr(0, slash)).children.push_back(std::wstring(path.substr(slash + 1)));
+    return key;
+}
+bool Registry::LoadSnapshot(const std::wstring& path) {
+    std::string bytes;
+    if (!ReadFileBytes(path, bytes)) return false;
+    std::wstring text;
+    if (bytes.size() >= 2 && (uint8_t)bytes[0] == 0xFF && (uint8_t)bytes[1] == 0xFE) {
+        text.resize((bytes.size() - 2) / 2);
+        for (size_t i = 0; i < text.size(); i++) text[i] = (wchar_t)((uint8_t)bytes[2 + 2 * i] | (uint8_t)bytes[3 + 2 * i] << 8);
+    }
+    else text = Utf8ToWide(std::string_view(bytes).substr(bytes.compare(0, 3, "\xEF\xBB\xBF") == 0 ? 3 : 0));
+    // "Name"="text" and @="text" with \\ and \" escapes, dword:<hex>, and hex(<type>):<bytes> (hex: is REG_BINARY) continued over
+    // lines ending in a backslash. [-Key] deletions and "Name"=- removals are skipped.
+    auto quoted = [](std::wstring_view line, size_t& p) {
+        std::wstring out;
+        for (p++; p < line.size() && line[p] != L'"'; p++) out += line[p] == L'\\' && p + 1 < line.size() ? line[++p] : line[p];
+        p++;
+        return out;
+    };
+    RegistrySnapshotKey* current = nullptr;
+    std::wstring line;
+    for (size_t start = 0, end; start < text.size(); start = end + 1) {
+        end = std::min(text.find(L'\n', start), text.size());
+        std::wstring_view part = std::wstring_view(text).substr(start, end - start);
+        while (!part.empty() && iswspace(part.back())) part.remove_suffix(1);
+        while (!part.empty() && iswspace(part.front())) part.remove_prefix(1);
+        line += part;
+        if (!line.empty() && line.back() == L'\\' && line[0] != L'[') { line.pop_back(); continue; }
+        if (!line.empty() && line[0] == L'[') current = line.size() > 2 && line[1] != L'-' && line.back() == L']' ? &AddSnapshotKey(std::wstring_view(line).substr(1, line.size() - 2)) : nullptr;
+        else if (current && !line.empty() && (line[0] == L'"' || line[0] == L'@')) {
+            size_t p = 0;
+            std::wstring name = line[0] == L'@' ? (p = 1, L"") : quoted(line, p);
+            std::wstring_view data = p < line.size() && line[p] == L'=' ? std::wstring_view(line).substr(p + 1) : std::wstring_view();
+            RegistryValue value;
+            if (!data.empty() && data[0] == L'"') { size_t q = 0; value.type = REG_SZ; value.text = quoted(data, q); }
+            else if (data.substr(0, 6) == L"dword:") { value.type = REG_DWORD; value.number = wcstoul(std::wstring(data.substr(6)).c_str(), nullptr, 16); }
+            else if (data.substr(0, 3) == L"hex") {
+                size_t colon = data.find(L':');
+                value.type = data.size() > 4 && data[3] == L'(' ? wcstoul(std::wstring(data.substr(4)).c_str(), nullptr, 16) : REG_BINARY;
+                std::vector<uint8_t> raw;
+                for (size_t i = colon == std::wstring_view::npos ? data.size() : colon + 1; i < data.size(); i++) {
+                    if (!iswxdigit(data[i])) continue;
+                    wchar_t pair[3] = { data[i], i + 1 < data.size() ? data[i + 1] : L'\0', 0 };
+                    raw.push_back((uint8_t)wcstoul(pair, nullptr, 16));
+                    i += iswxdigit(pair[1]) ? 1 : 0;
+                }
+                if (value.type == REG_SZ || value.type == REG_EXPAND_SZ || value.type == REG_MULTI_SZ) {
+                    for (size_t i = 0; i + 1 < raw.size(); i += 2) value.text += (wchar_t)(raw[i] | raw[i + 1] << 8);
+                    while (!value.text.empty() && value.text.back() == 0) value.text.pop_back();
+                }
+                else for (size_t i = 0; i < raw.size() && i < 8; i++) value.number |= (uint64_t)raw[i] << (8 * i);
+            }
+            if (value.type != REG_NONE) current->values[SnapshotKeyPath(name)] = value;
+        }
+        line.clear();
+    }
+    fromSnapshot = true;
+    return true;
+}
+// FindExecutableInDir behind the library cache: the walk reruns only when the install folder's mtime or the chosen exe's
+// (mtime, size) moved. Safe to call from pool workers.
+std::wstring ResolveExecutable(const std::wstring& dirPath, std::wstring_view gameName) {
+    FileStamp dirStamp, exeStamp;
+    if (!GetFileStamp(dirPath, dirStamp)) return L"";
+    ScanCacheExeEntry entry;
+    bool hit = g_scanCache.LookupExe(dirPath, entry) && entry.dirMtime == dirStamp.mtime
+        && (entry.exe.empty() || (GetFileStamp(entry.exe, exeStamp) && exeStamp.mtime == entry.exeStamp.mtime && exeStamp.size == entry.exeStamp.size));
+    if (!hit) {
+        entry = {dirPath, FindExecutableInDir(dirPath, gameName), dirStamp.mtime};
+        if (!entry.exe.empty()) GetFileStamp(entry.exe, entry.exeStamp);
+    }
+    g_scanCache.StoreExe(entry);
+    return entry.exe;
+}
+// Install folders without launch metadata are walked breadth-first, at most kExeSearchDepth levels down, and every .exe is scored
+// by ScoreExecutable. Only a name that could still beat the best candidate has its headers read for ScorePeInfo. Levels finish
+// in order, so the walk ends once nothing deeper could win.
+const int kExeSearchDepth = 5, kExeSearchMaxEntries = 20000, kExeScoreExactName = 100, kExeScoreMaxSize = 20, kExeScorePerLevel = 15;
+const int kExeScorePeGui = 20, kExeScorePe64 = 5, kExeScorePeProduct = 15, kExeScoreMaxPe = kExeScorePeGui + kExeScorePe64 + kExeScorePeProduct;
+std::wstring FindExecutableInDir(const std::wstring& dirPath, std::wstring_view gameName) {
+    std::wstring root = dirPath;
+    while (root.size() > 3 && (root.back() == L'\\' || root.back() == L'/')) root.pop_back();
+    std::deque<std::pair<std::wstring, int>> pending = {{root, 0}};
+    std::wstring best, gameKey = MatchKey(gameName);
+    int bestScore = INT_MIN, visited = 0;
+    while (!pending.empty() && visited < kExeSearchMaxEntries) {
+        auto [dir, depth] = std::move(pending.front());
+        pending.pop_front();
+        DirectoryReader reader;
+        DirEntry entry;
+        if (!reader.Open(dir)) continue;
+        while (reader.Next(entry)) {
+            if (++visited > kExeSearchMaxEntries) break;
+            std::wstring_view name = entry.name;
+            if (entry.isDirectory) {
+                // Junctions could loop back, so they are not followed.
+                if (entry.isReparsePoint || depth >= kExeSearchDepth) continue;
+                std::wstring child = dir + L"\\" + entry.name;
+                if (!g_exclusions.Excludes(std::wstring_view(child).substr(root.size() + 1), gameKey)) pending.push_back({child, depth + 1});
+                continue;
+            }
+            if (name.size() <= 4 || _wcsicmp(entry.name + name.size() - 4, L".exe") != 0) continue;
+            int score = ScoreExecutable(name, gameName, depth, entry.size);
+            if (score == INT_MIN || score + kExeScoreMaxPe <= bestScore) continue;
+            std::wstring path = dir + L"\\" + entry.name;
+            PeInfo pe;
+            int peScore = ReadPeInfo(path, pe) ? ScorePeInfo(pe, gameName) : INT_MIN;
+            if (peScore == INT_MIN) continue;
+            score += peScore;
+            if (score > bestScore) { best = path; bestScore = score; }
+            // The game's own name on a GUI binary is as sure as this search gets.
+            if (score >= kExeScoreExactName + kExeScorePeGui - kExeScorePerLevel * depth) return best;
+        }
+        if (!pending.empty() && pending.front().second > depth && bestScore >= kExeScoreExactName + kExeScoreMaxSize + kExeScoreMaxPe - kExeScorePerLevel * (depth + 1)) break;
+    }
+    return best;
+}
+// How likely an .exe is the game itself: similarity of its name to the game's (up to kExeScoreExactName), a bonus for size (up
+// to kExeScoreMaxSize), minus kExeScorePerLevel per folder level. Uninstallers, crash reporters and redistributable setups
+// score INT_MIN; launchers, editors, servers and config tools are only penalized since some games ship nothing else.
+int ScoreExecutable(std::wstring_view fileName, std::wstring_view gameName, int depth, uint64_t size) {
+    std::wstring stem = MatchKey(fileName.substr(0, fileName.size() - 4)), name = MatchKey(gameName);
+    auto has = [&stem](const wchar_t* part) { return stem.find(part) != std::wstring::npos; };
+    // A banned word that is part of the game's own name ("Crash Bandicoot", "CrashDay") bans nothing.
+    for (const wchar_t* part : { L"unins", L"crash", L"redist", L"prereq", L"dxsetup", L"dotnetfx", L"bugreport", L"errorreport", L"cefprocess" })
+        if (has(part) && name.find(part) == std::wstring::npos) return INT_MIN;
+    std::vector<std::wstring> words;
+    std::wstring acronym;
+    for (size_t i = 0; i < gameName.size();) {
+        while (i < gameName.size() && !iswalnum(gameName[i])) i++;
+        size_t start = i;
+        while (i < gameName.size() && iswalnum(gameName[i])) i++;
+        if (i == start) continue;
+        acronym += (wchar_t)towlower(gameName[start]);
+        if (i - start >= 3) words.push_back(MatchKey(gameName.substr(start, i - start)));
+    }
+    auto similarity = [&](const std::wstring& key) {
+        if (key.empty() || name.empty()) return 0;
+        if (key == name) return kExeScoreExactName;
+        if ((key.size() >= 3 && name.rfind(key, 0) == 0) || (name.size() >= 3 && key.rfind(name, 0) == 0)) return 70;
+        if (acronym.size() >= 2 && key == acronym) return 60;
+        int hits = 0;
+        for (const auto& word : words) hits += key.find(word) != std::wstring::npos;
+        return words.empty() ? 0 : 60 * hits / (int)words.size();
+    };
+    // Unreal and friends append the build flavour: "Game-Win64-Shipping.exe" is still "Game".
+    std::wstring base = stem;
+    for (const wchar_t* suffix : { L"win64shipping", L"shipping", L"win64", L"win32", L"x64", L"x86", L"64" }) {
+        size_t length = wcslen(suffix);
+        if (base.size() > length && base.compare(base.size() - length, length, suffix) == 0) base.resize(base.size() - length);
+    }
+    int score = std::max(similarity(stem), similarity(base)) - kExeScorePerLevel * depth;
+    for (const wchar_t* part : { L"launcher", L"setup", L"install", L"update", L"config", L"settings", L"server", L"editor", L"benchmark", L"helper" }) if (has(part)) { score -= 40; break; }
+    int sizeBonus = 0;
+    for (uint64_t megabytes = size >> 20; megabytes && sizeBonus < kExeScoreMaxSize; megabytes >>= 1) sizeBonus += 2;
+    return score + sizeBonus;
+}
+// The image is mapped rather than read, so ParsePeHeaders sees the whole file while only the pages it touches are read.
+bool ReadPeInfo(const std::wstring& path, PeInfo& info) {
+    MappedFile image;
+    return image.Open(path) && ParsePeHeaders(image.data, image.size, info);
+}
+// Parses a whole image held in memory: the headers (the first kPeHeaderBytes), at most kPeResourceBytes of the resource
+// directory and kPeVersionBytes of the version resource, so ranking a candidate touches three small ranges however large the
+// binary is. Returns false for anything not a PE image.
+bool ParsePeHeaders(const uint8_t* data, size_t size, PeInfo& info) {
+    std::string_view image((const char*)data, size);
+    auto span = [&image](uint64_t offset, size_t length) { return offset < image.size() ? image.substr((size_t)offset, length) : std::string_view(); };
+    // Little-endian reads that yield 0 past the end of the span, so a truncated or hostile file cannot walk off it.
+    auto u16 = [](std::string_view b, size_t at) -> uint32_t { return at + 2 <= b.size() ? (uint8_t)b[at] | (uint32_t)(uint8_t)b[at + 1] << 8 : 0; };
+    auto u32 = [&u16](std::string_view b, size_t at) -> uint32_t { return at + 4 <= b.size() ? u16(b, at) | u16(b, at + 2) << 16 : 0; };
+    std::string_view headers = span(0, kPeHeaderBytes), resources, version;
+    size_t pe = 0;
+    bool ok = u16(headers, 0) == 0x5A4D && u32(headers, pe = u32(headers, 0x3C)) == 0x00004550;
+    uint32_t magic = ok ? u16(headers, pe + 24) : 0;
+    if (magic != 0x10B && magic != 0x20B) return false;
+    info.machine = (uint16_t)u16(headers, pe + 4);
+    info.isDll = (u16(headers, pe + 22) & kPeFileDll) != 0;
+    size_t optional = pe + 24, sections = optional + u16(headers, pe + 20), directories = optional + (magic == 0x20B ? 112 : 96);
+    info.subsystem = (uint16_t)u16(headers, optional + 68);
+    uint32_t directoryCount = u32(headers, directories - 4);
+    uint32_t resourceRva = directoryCount > 2 ? u32(headers, directories + 16) : 0, resourceSize = directoryCount > 2 ? u32(headers, directories + 20) : 0;
+    uint32_t certOffset = directoryCount > 4 ? u32(headers, directories + 32) : 0, certSize = directoryCount > 4 ? u32(headers, directories + 36) : 0;
+    info.isSigned = certOffset && certSize;
+    uint64_t imageEnd = 0;
+    uint32_t resourceVa = 0, resourceRaw = 0;
+    for (uint32_t i = 0, count = u16(headers, pe + 6); i < count && sections + 40 * (i + 1) <= headers.size(); i++) {
+        size_t section = sections + 40 * i;
+        uint32_t va = u32(headers, section + 12), rawSize = u32(headers, section + 16), raw = u32(headers, section + 20);
+        imageEnd = std::max<uint64_t>(imageEnd, (uint64_t)raw + rawSize);
+        if (resourceRva >= va && resourceRva < va + std::max(u32(headers, section + 8), rawSize)) { resourceVa = va; resourceRaw = raw; }
+    }
+    // Resource tree: type, then name, then language. RT_VERSION (16) leads to one data entry, whose address is an RVA.
+    if (resourceRaw && !(resources = span((uint64_t)resourceRaw + (resourceRva - resourceVa), std::min<size_t>(resourceSize, kPeResourceBytes))).empty()) {
+        auto child = [&](uint32_t dir, bool any, uint32_t id) -> uint32_t {
+            for (uint32_t e = 0, count = u16(resources, dir + 12) + u16(resources, dir + 14); e < count; e++) {
+                uint32_t name = u32(resources, dir + 16 + 8 * e), target = u32(resources, dir + 20 + 8 * e);
+                if (any || name == id) return target;
+            }
+            return 0;
+        };
+        uint32_t types = child(0, false, 16), names = types & 0x80000000 ? child(types & 0x7FFFFFFF, true, 0) : 0;
+        uint32_t entry = names & 0x80000000 ? child(names & 0x7FFFFFFF, true, 0) : 0;
+        uint32_t dataRva = entry && !(entry & 0x80000000) ? u32(resources, entry) : 0;
+        if (dataRva >= resourceVa) version = span((uint64_t)resourceRaw + (dataRva - resourceVa), std::min<size_t>(u32(resources, entry + 4), kPeVersionBytes));
+    }
+    // VS_VERSIONINFO: nested blocks of wLength, wValueLength, wType, a UTF-16 key and a value, each aligned to 4 bytes. The
+    // strings sit at VS_VERSION_INFO / StringFileInfo / <language> / <name>; the first language table is the one used.
+    std::function<void(size_t, size_t, int)> walk = [&](size_t at, size_t end, int depth) {
+        while (at + 6 <= end) {
+            size_t length = u16(version, at), valueLength = u16(version, at + 2), p = at + 6;
+            if (length < 6 || at + length > end) return;
+            std::wstring key, value;
+            for (; p + 2 <= at + length && u16(version, p); p += 2) key += (wchar_t)u16(version, p);
+            p = (p + 2 + 3) & ~(size_t)3;
+            if (depth == 3) {
+                for (size_t c = 0; c < valueLength && p + 2 <= at + length && u16(version, p); c++, p += 2) value += (wchar_t)u16(version, p);
+                if (key == L"ProductName" && info.productName.empty()) info.productName = value;
+                else if (key == L"FileDescription" && info.fileDescription.empty()) info.fileDescription = value;
+            }
+            else if (depth != 1 || key == L"StringFileInfo") walk((p + (depth == 0 ? valueLength : 0) + 3) & ~(size_t)3, at + length, depth + 1);
+            at = (at + length + 3) & ~(size_t)3;
+            if (depth == 2) return;
+        }
+    };
+    walk(0, version.size(), 0);
+    // A signed setup package is a small stub with its payload appended after the sections, ahead of the certificate.
+    uint64_t payloadEnd = info.isSigned && certOffset >= imageEnd ? certOffset : (uint64_t)size;
+    std::wstring text = MatchKey(info.fileDescription + L" " + info.productName);
+    info.installerStub = info.isSigned && (payloadEnd > imageEnd + (1 << 20) || text.find(L"setup") != std::wstring::npos || text.find(L"installer") != std::wstring::npos);
+    return true;
+}
+// Adjusts a name score by what the headers say: GUI over console, native 64-bit over 32-bit, and a bonus when the version
+// resource names the game. Installer stubs and DLLs are never candidates.
+int ScorePeInfo(const PeInfo& info, std::wstring_view gameName) {
+    if (info.installerStub || info.isDll) return INT_MIN;
+    int score = info.subsystem == kPeSubsystemGui ? kExeScorePeGui : info.subsystem == kPeSubsystemConsole ? -25 : 0;
+    if (info.machine == kPeMachineAmd64 || info.machine == kPeMachineArm64) score += kExeScorePe64;
+    std::wstring name = MatchKey(gameName);
+    if (!name.empty() && (MatchKey(info.productName) == name || MatchKey(info.fileDescription) == name)) score += kExeScorePeProduct;
+    return score;
+}
+// Subtrees that never hold the game binary: redistributables and their installers, crash reporters, VCS metadata, shader and
+// derived-data caches, Unreal's third-party and engine content, and Unity's <Game>_Data folder.
+const wchar_t* const kDefaultExclusions[] = { L"_CommonRedist", L"*Redist*", L"*Prereq*", L"__Installer", L"*Installer*", L"DirectX", L"dotnet*", L"*Crash*",
+    L".git", L".svn", L"*ShaderCache*", L"DerivedDataCache", L"Support", L"Engine/Binaries/ThirdParty", L"Engine/Content", L"Engine/Extras", L"*_Data", L"MonoBleedingEdge" };
+void LoadExclusions(const std::wstring& path) {
+    g_exclusions = ExclusionSet();
+    for (const wchar_t* pattern : kDefaultExclusions) g_exclusions.Add(pattern, true);
+    std::string data;
+    if (!ReadFileBytes(path, data)) return;
+    std::wstring text = Utf8ToWide(data);
+    for (size_t start = 0, end; start < text.size(); start = end + 1) {
+        end = std::min(text.find(L'\n', start), text.size());
+        std::wstring_view line = std::wstring_view(text).substr(start, end - start);
+        while (!line.empty() && iswspace(line.back())) line.remove_suffix(1);
+        while (!line.empty() && (iswspace(line.front()) || line.front() == 0xFEFF)) line.remove_prefix(1);
+        if (!line.empty() && line.front() != L'#') g_exclusions.Add(line);
+    }
+}
+void ExclusionSet::Add(std::wstring_view pattern, bool builtIn) {
+    std::wstring key;
+    for (wchar_t c : pattern) key += c == L'\\' ? L'/' : (wchar_t)towlower(c);
+    while (!key.empty() && key.back() == L'/') key.pop_back();
+    while (!key.empty() && key.front() == L'/') key.erase(0, 1);
+    if (key.empty()) return;
+    signature = Crc32(signature, key.c_str(), (key.size() + 1) * sizeof(wchar_t));
+    bool glob = key.find_first_of(L"*?") != std::wstring::npos, path = key.find(L'/') != std::wstring::npos;
+    std::wstring token = builtIn ? MatchKey(key) : L"";
+    if (glob) (path ? pathGlobs : nameGlobs).push_back({key, std::move(token)});
+    else (path ? paths : names).emplace(key, std::move(token));
+}
+bool ExclusionSet::Excludes(std::wstring_view relativePath, std::wstring_view gameKey) const {
+    std::wstring key;
+    for (wchar_t c : relativePath) key += c == L'\\' ? L'/' : (wchar_t)towlower(c);
+    auto applies = [gameKey](const std::wstring& token) { return token.empty() || gameKey.find(token) == std::wstring_view::npos; };
+    std::wstring_view name = std::wstring_view(key).substr(key.rfind(L'/') + 1);
+    auto literal = names.find(std::wstring(name));
+    if (literal != names.end() && applies(literal->second)) return true;
+    for (const auto& glob : nameGlobs) if (GlobMatch(glob.first, name) && applies(glob.second)) return true;
+    if (paths.empty() && pathGlobs.empty()) return false;
+    for (size_t at = 0; at < key.size(); at = key.find(L'/', at) + 1) {
+        std::wstring_view tail = std::wstring_view(key).substr(at);
+        if (tail.find(L'/') == std::wstring_view::npos) break;
+        auto path = paths.find(std::wstring(tail));
+        if (path != paths.end() && applies(path->second)) return true;
+        for (const auto& glob : pathGlobs) if (GlobMatch(glob.first, tail) && applies(glob.second)) return true;
+    }
+    return false;
+}
+// * matches any run of characters (slashes included), ? any one character.
+bool GlobMatch(std::wstring_view pattern, std::wstring_view text) {
+    size_t p = 0, t = 0, star = std::wstring_view::npos, mark = 0;
+    while (t < text.size()) {
+        if (p < pattern.size() && (pattern[p] == L'?' || pattern[p] == text[t])) { p++; t++; }
+        else if (p < pattern.size() && pattern[p] == L'*') { star = p++; mark = t; }
+        else if (star != std::wstring_view::npos) { p = star + 1; t = ++mark; }
+        else return false;
+    }
+    while (p < pattern.size() && pattern[p] == L'*') p++;
+    return p == pattern.size();
+}
+std::wstring MatchKey(std::wstring_view text) {
+    std::wstring key;
+    for (wchar_t c : text) if (iswalnum(c)) key += (wchar_t)towlower(c);
+    return key;
+}
+bool ReadFileBytes(const std::wstring& path, std::string& out) {
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size = {}; DWORD read = 0;
+    bool ok = GetFileSizeEx(file, &size) && size.QuadPart < 0x7FFFFFFF;
+    if (ok) { out.resize((size_t)size.QuadPart); ok = out.empty() || (ReadFile(file, &out[0], (DWORD)out.size(), &read, nullptr) && read == out.size()); }
+    CloseHandle(file);
+    return ok;
+}
+std::wstring Utf8ToWide(std::string_view text) {
+    if (text.empty()) return L"";
+    std::wstring out(MultiByteToWideChar(CP_UTF8, 0, text.data(), (int)text.size(), nullptr, 0), L'\0');
+    MultiByteToWideChar(CP_UTF8, 0, text.data(), (int)text.size(), &out[0], (int)out.size());
+    return out;
+}
+std::string WideToUtf8(std::wstring_view text) {
+    if (text.empty()) return "";
+    std::string out(WideCharToMultiByte(CP_UTF8, 0, text.data(), (int)text.size(), nullptr, 0, nullptr, nullptr), '\0');
+    WideCharToMultiByte(CP_UTF8, 0, text.data(), (int)text.size(), &out[0], (int)out.size(), nullptr, nullptr);
+    return out;
+}
+uint64_t ParseUint(std::string_view text) { uint64_t value = 0; std::from_chars(text.data(), text.data() + text.size(), value); return value; }
+std::wstring JsonEscape(const std::wstring& text) {
+    std::wstring out;
+    out.reserve(text.size());
+    for (wchar_t c : text) {
+        if (c == L'"' || c == L'\\') { out += L'\\'; out += c; }
+        else if (c < 0x20) { wchar_t escaped[8]; swprintf(escaped, 8, L"\\u%04x", (unsigned)c); out += escaped; }
+        else out += c;
+    }
+    return out;
+}
+std::wstring GameToJson(const Game& game) {
+    std::wstring foundBy;
+    for (const auto& source : game.foundBy) foundBy += (foundBy.empty() ? L"\"" : L",\"") + JsonEscape(source) + L"\"";
+    if (game.foundBy.empty()) foundBy = L"\"" + JsonEscape(game.source) + L"\"";
+    return L"{\"key\":\"" + JsonEscape(GameKey(game)) + L"\",\"name\":\"" + JsonEscape(game.name) + L"\",\"path\":\"" + JsonEscape(game.path) + L"\",\"appId\":\"" + JsonEscape(game.appId)
+        + L"\",\"sizeOnDisk\":" + std::to_wstring(game.sizeOnDisk) + L",\"lastUpdated\":" + std::to_wstring(game.lastUpdated)
+        + L",\"bytesToDownload\":" + std::to_wstring(game.bytesToDownload) + L",\"buildId\":" + std::to_wstring(game.buildId)
+        + L",\"lastPlayed\":" + std::to_wstring(game.lastPlayed) + L",\"playtime\":" + std::to_wstring(game.playtimeMinutes)
+        + L",\"source\":\"" + JsonEscape(game.source) + L"\",\"launchOptions\":\"" + JsonEscape(game.launchOptions) + L"\",\"startDir\":\"" + JsonEscape(game.startDir) + L"\",\"art\":\"" + JsonEscape(game.art) + L"\""
+        + L",\"updatePending\":" + ((game.stateFlags & kAppStateUpdateRequired) ? L"true" : L"false") + L",\"foundBy\":[" + foundBy + L"]}";
+}
+bool IsAsciiDigits(std::string_view text) { if (text.empty()) return false; for (char c : text) if (c < '0' || c > '9') return false; return true; }
+bool KvKeyEquals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) { char x = a[i], y = b[i]; if (x != y && ((x | 0x20) != (y | 0x20) || (unsigned)((x | 0x20) - 'a') > 25u)) return false; }
+    return true;
+}
+int KvTree::Find(int parent, std::string_view key) const {
+    if (parent < 0 || parent >= (int)nodes.size()) return -1;
+    for (int i = nodes[parent].firstChild; i != -1; i = nodes[i].nextSibling) if (KvKeyEquals(nodes[i].key, key)) return i;
+    return -1;
+}
+std::string_view KvTree::Get(int parent, std::string_view key) const { int i = Find(parent, key); return (i != -1 && !nodes[i].isBlock) ? nodes[i].value : std::string_view(); }
+// Returns '"' for a quoted or bare string, '{' or '}' for braces and 0 at end of input. Quoted strings are unescaped in place,
+// which never grows them, so `text` can point back into the caller's buffer. Comments and [$PLATFORM] conditionals are skipped.
+static const char* KvSkipTrivia(const char* p, const char* end) {
+    for (;;) {
+        while (p < end && (unsigned char)*p <= ' ') p++;
+        if (p + 1 < end && p[0] == '/' && p[1] == '/') { while (p < end && *p != '\n') p++; continue; }
+        if (p < end && *p == '[') { while (p < end && *p != ']') p++; if (p < end) p++; continue; }
+        return p;
+    }
+}
+static char KvNextToken(char*& p, char* end, std::string_view& text) {
+    p += KvSkipTrivia(p, end) - p;
+    if (p >= end) return 0;
+    if (*p == '{' || *p == '}') return *p++;
+    char* start = p;
+    if (*p == '"') {
+        char* out = start = ++p;
+        while (p < end && *p != '"') {
+            if (*p == '\\' && p + 1 < end) { p++; *out++ = *p == 'n' ? '\n' : *p == 't' ? '\t' : *p; p++; }
+            else *out++ = *p++;
+        }
+        text = std::string_view(start, out - start);
+        if (p < end) p++;
+        return '"';
+    }
+    while (p < end && (unsigned char)*p > ' ' && *p != '{' && *p != '}' && *p != '"') p++;
+    text = std::string_view(start, p - start);
+    return '"';
+}
+bool ParseKeyValues(char* data, size_t size, KvTree& tree) {
+    tree.nodes.clear();
+    tree.nodes.reserve(size / 24 + 1);
+    tree.nodes.push_back({});
+    tree.nodes[0].isBlock = true;
+    std::vector<int> parents{0}, lastChild{-1};
+    char* p = data; char* end = data + size;
+    if (size >= 3 && memcmp(p, "\xEF\xBB\xBF", 3) == 0) p += 3;
+    for (;;) {
+        KvNode node;
+        char token = KvNextToken(p, end, node.key);
+        if (token == 0) return parents.size() == 1;
+        if (token == '}') { if (parents.size() == 1) return false; parents.pop_back(); lastChild.pop_back(); continue; }
+        if (token == '{') return false;
+        token = KvNextToken(p, end, node.value);
+        if (token == '{') { node.isBlock = true; node.value = {}; }
+        else if (token != '"') return false;
+        int index = (int)tree.nodes.size();
+        tree.nodes.push_back(node);
+        if (lastChild.back() == -1) tree.nodes[parents.back()].firstChild = index; else tree.nodes[lastChild.back()].nextSibling = index;
+        lastChild.back() = index;
+        if (node.isBlock) { parents.push_back(index); lastChild.push_back(-1); }
+    }
+}
+// Read-only counterpart of KvNextToken for StreamKeyValues: strings come back raw, with escape sequences left as written.
+static char KvScanToken(const char*& p, const char* end, std::string_view& text) {
+    p = KvSkipTrivia(p, end);
+    if (p >= end) return 0;
+    if (*p == '{' || *p == '}') return *p++;
+    const char* start = p;
+    if (*p == '"') {
+        start = ++p;
+        while (p < end && *p != '"') p += (*p == '\\' && p + 1 < end) ? 2 : 1;
+        text = std::string_view(start, p - start);
+        if (p < end) p++;
+        return '"';
+    }
+    while (p < end && (unsigned char)*p > ' ' && *p != '{' && *p != '}' && *p != '"') p++;
+    text = std::string_view(start, p - start);
+    return '"';
+}
+// Moves past the '}' that closes a block whose '{' was just consumed, matching braces outside strings and comments.
+static const char* KvSkipBlock(const char* p, const char* end) {
+    for (int depth = 1; p < end;) {
+        char c = *p++;
+        if (c == '"') { while (p < end && *p != '"') p += (*p == '\\' && p + 1 < end) ? 2 : 1; if (p < end) p++; }
+        else if (c == '/' && p < end && *p == '/') { while (p < end && *p != '\n') p++; }
+        else if (c == '{') depth++;
+        else if (c == '}' && --depth == 0) break;
+    }
+    return p;
+}
+// Walks KeyValues text without building a tree or allocating. `query` is a slash-separated block path ("*" matches any key,
+// comparisons ignore case); blocks off that path are skipped wholesale by brace matching. Every plain value directly inside a
+// block at the end of the path is reported as (that block's key, value key, value).
+void StreamKeyValues(std::string_view data, std::string_view query, const std::function<void(std::string_view, std::string_view, std::string_view)>& onValue) {
+    std::string_view parts[16];
+    size_t partCount = 0;
+    for (size_t start = 0; start <= query.size() && partCount < 16;) {
+        size_t slash = std::min(query.find('/', start), query.size());
+        parts[partCount++] = query.substr(start, slash - start);
+        start = slash + 1;
+    }
+    const char* p = data.data(); const char* end = p + data.size();
+    size_t depth = 0;
+    std::string_view block;
+    for (;;) {
+        std::string_view key, value;
+        char token = KvScanToken(p, end, key);
+        if (token == 0 || token == '{' || (token == '}' && depth == 0)) return;
+        if (token == '}') { depth--; continue; }
+        token = KvScanToken(p, end, value);
+        if (token == '"') { if (depth == partCount) onValue(block, key, value); continue; }
+        if (token != '{') return;
+        if (depth < partCount && (parts[depth] == "*" || KvKeyEquals(parts[depth], key))) { if (++depth == partCount) block = key; }
+        else p = KvSkipBlock(p, end);
+    }
+}
+void ListSteamUsers(const std::wstring& steamPath, std::vector<std::wstring>& userDirs) {
+    DirectoryReader reader;
+    DirEntry entry;
+    if (!reader.Open(steamPath + L"\\userdata")) return;
+    while (reader.Next(entry)) {
+        std::wstring_view userId = entry.name;
+        if (entry.isDirectory && userId.find_first_not_of(L"0123456789") == std::wstring_view::npos) userDirs.push_back(steamPath + L"\\userdata\\" + entry.name);
+    }
+}
+void ReadSteamPlaytime(const std::vector<std::wstring>& userDirs, std::unordered_map<uint64_t, SteamPlaytime>& playtime) {
+    std::vector<std::unordered_map<uint64_t, SteamPlaytime>> perUser(userDirs.size());
+    g_workerPool.ParallelFor(userDirs.size(), [&](size_t i) {
+        std::string data;
+        if (!ReadFileBytes(userDirs[i] + L"\\config\\localconfig.vdf", data)) return;
+        StreamKeyValues(data, "UserLocalConfigStore/Software/Valve/Steam/apps/*", [&](std::string_view appId, std::string_view key, std::string_view value) {
+            if (KvKeyEquals(key, "LastPlayed")) perUser[i][ParseUint(appId)].lastPlayed = ParseUint(value);
+            else if (KvKeyEquals(key, "Playtime")) perUser[i][ParseUint(appId)].minutes = ParseUint(value);
+        });
+    });
+    // Several accounts on one PC: the most recent session wins, minutes add up.
+    for (const auto& user : perUser) for (const auto& [appId, entry] : user) {
+        SteamPlaytime& merged = playtime[appId];
+        merged.lastPlayed = std::max(merged.lastPlayed, entry.lastPlayed);
+        merged.minutes += entry.minutes;
+    }
+}
+void ReadBattleNetProducts(const uint8_t* data, size_t size, std::vector<BattleNetProduct>& products) {
+    auto nested = [](std::string_view view) { return ProtoReader{ (const uint8_t*)view.data(), (const uint8_t*)view.data() + view.size() }; };
+    ProtoReader db = { data, data + size };
+    uint32_t field; uint8_t wireType;
+    while (db.Next(field, wireType)) {
+        if (field != kPdbProductInstall || wireType != kProtoBytes) { db.Skip(wireType); continue; }
+        BattleNetProduct product;
+        ProtoReader install = nested(db.Bytes());
+        while (install.Next(field, wireType)) {
+            if (wireType != kProtoBytes) install.Skip(wireType);
+            else if (field == kPdbProductCode) product.code = install.Bytes();
+            else if (field == kPdbSettings) {
+                ProtoReader settings = nested(install.Bytes());
+                while (settings.Next(field, wireType)) {
+                    if (field == kPdbInstallPath && wireType == kProtoBytes) product.installPath = settings.Bytes();
+                    else settings.Skip(wireType);
+                }
+            }
+            else if (field == kPdbCachedState) {
+                ProtoReader state = nested(install.Bytes());
+                while (state.Next(field, wireType)) {
+                    if (field != kPdbBaseState || wireType != kProtoBytes) { state.Skip(wireType); continue; }
+                    ProtoReader base = nested(state.Bytes());
+                    while (base.Next(field, wireType)) {
+                        if (field == kPdbInstalled && wireType == kProtoVarint) product.installed = base.Varint() != 0;
+                        else if (field == kPdbPlayable && wireType == kProtoVarint) product.playable = base.Varint() != 0;
+                        else if (field == kPdbVersion && wireType == kProtoBytes) product.version = base.Bytes();
+                        else base.Skip(wireType);
+                    }
+                }
+            }
+            else install.Skip(wireType);
+        }
+        products.push_back(product);
+    }
+}
+bool ProtoReader::Next(uint32_t& field, uint8_t& wireType) {
+    if (p >= end) return false;
+    uint64_t key = Varint();
+    field = (uint32_t)(key >> 3);
+    wireType = (uint8_t)(key & 7);
+    return field != 0 && p <= end;
+}
+uint64_t ProtoReader::Varint() {
+    uint64_t value = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t byte = *p++;
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+    p = end;
+    return 0;
+}
+std::string_view ProtoReader::Bytes() {
+    uint64_t length = Varint();
+    if (length > (uint64_t)(end - p)) { p = end; return {}; }
+    std::string_view bytes((const char*)p, (size_t)length);
+    p += length;
+    return bytes;
+}
+void ProtoReader::Skip(uint8_t wireType) {
+    switch (wireType) {
+    case kProtoVarint: Varint(); break;
+    case kProtoFixed64: p = end - p < 8 ? end : p + 8; break;
+    case kProtoBytes: Bytes(); break;
+    case kProtoFixed32: p = end - p < 4 ? end : p + 4; break;
+    default: p = end; break; // Groups are long deprecated and nothing here writes them
+    }
+}
+bool BinaryKvReader::Next(uint8_t& type, std::string_view& key) {
+    if (p >= end) return false;
+    type = *p++;
+    if (type == kBinKvEnd || type == kBinKvEndAlt) return false;
+    if (keyTable) { uint32_t index = Int32(); key = index < keyTable->size() ? (*keyTable)[index] : std::string_view(); }
+    else key = String();
+    return p < end;
+}
+std::string_view BinaryKvReader::String() {
+    const uint8_t* terminator = (const uint8_t*)memchr(p, 0, end - p);
+    if (!terminator) { p = end; return {}; }
+    std::string_view text((const char*)p, terminator - p);
+    p = terminator + 1;
+    return text;
+}
+uint32_t BinaryKvReader::Int32() { uint32_t value = 0; if (end - p < 4) { p = end; return 0; } memcpy(&value, p, 4); p += 4; return value; }
+uint64_t BinaryKvReader::UInt64() { uint64_t value = 0; if (end - p < 8) { p = end; return 0; } memcpy(&value, p, 8); p += 8; return value; }
+void BinaryKvReader::Skip(uint8_t type) {
+    uint8_t childType; std::string_view childKey;
+    switch (type) {
+    case kBinKvMap: while (Next(childType, childKey)) Skip(childType); break;
+    case kBinKvString: String(); break;
+    case kBinKvInt32: case kBinKvFloat: case kBinKvPointer: case kBinKvColor: Int32(); break;
+    case kBinKvUInt64: case kBinKvInt64: UInt64(); break;
+    case kBinKvWideString: while (end - p >= 2 && (p[0] | p[1])) p += 2; p = std::min(p + 2, end); break;
+    default: p = end; break;
+    }
+}
+bool MappedFile::Open(const std::wstring& path) {
+    Close();
+    file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER fileSize = {};
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping) data = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data) { Close(); return false; }
+    size = (size_t)fileSize.QuadPart;
+    return true;
+}
+void MappedFile::Close() {
+    if (data) UnmapViewOfFile(data);
+    if (mapping) CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+    data = nullptr; size = 0; mapping = nullptr; file = INVALID_HANDLE_VALUE;
+}
+bool DirectoryReader::Open(const std::wstring& dir) {
+    if (find != INVALID_HANDLE_VALUE) FindClose(find);
+    find = FindFirstFileExW((dir + L"\\*").c_str(), FindExInfoBasic, &data, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+    pending = find != INVALID_HANDLE_VALUE;
+    return pending;
+}
+bool DirectoryReader::Next(DirEntry& entry) {
+    for (;;) {
+        if (!pending && (find == INVALID_HANDLE_VALUE || !FindNextFileW(find, &data))) return false;
+        pending = false;
+        if (data.cFileName[0] == L'.' && (data.cFileName[1] == 0 || (data.cFileName[1] == L'.' && data.cFileName[2] == 0))) continue;
+        entry.name = data.cFileName;
+        entry.size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+        entry.mtime = ((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+        entry.isDirectory = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+        entry.isReparsePoint = (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0;
+        return true;
+    }
+}
+bool SteamAppInfoFile::Open(const std::wstring& path) {
+    if (!mapped.Open(path)) return false;
+    const uint8_t* end = mapped.data + mapped.size;
+    BinaryKvReader header = { mapped.data, end };
+    magic = header.Int32();
+    header.Int32(); // universe
+    if (magic != kAppInfoMagicV27 && magic != kAppInfoMagicV28 && magic != kAppInfoMagicV29) { mapped.Close(); return false; }
+    // v29 stores each key once in a table at the end of the file; the entries refer to keys by index.
+    if (magic == kAppInfoMagicV29) {
+        uint64_t tableOffset = header.UInt64();
+        if (tableOffset < (uint64_t)(header.p - mapped.data) || tableOffset > mapped.size - 4) { mapped.Close(); return false; }
+        BinaryKvReader table = { mapped.data + tableOffset, end };
+        uint32_t count = table.Int32();
+        keyTable.reserve(std::min<size_t>(count, table.end - table.p));
+        for (uint32_t i = 0; i < count && table.p < end; i++) keyTable.push_back(table.String());
+        end = mapped.data + tableOffset;
+    }
+    // Per app: appid, the size of the rest of the entry, a fixed header (change number, tokens, hashes), then the KeyValues.
+    size_t headerSize = magic == kAppInfoMagicV27 ? 40 : 60;
+    while (end - header.p >= 8) {
+        uint32_t appId = header.Int32(), size = header.Int32();
+        if (appId == 0 || size < headerSize || size > (size_t)(end - header.p)) break;
+        entries.emplace(appId, std::make_pair((size_t)(header.p - mapped.data) + headerSize, (size_t)size - headerSize));
+        header.p += size;
+    }
+    return true;
+}
+std::shared_ptr<const SteamAppInfoFile> SteamAppInfoIndex::Get(const std::wstring& appInfoPath) {
+    FileStamp current;
+    GetFileStamp(appInfoPath, current);
+    std::lock_guard<std::mutex> guard(lock);
+    if (file && path == appInfoPath && current.mtime == stamp.mtime && current.size == stamp.size) return file;
+    // Manifests resolving in parallel wait here for the one index rather than each building their own.
+    auto opened = std::make_shared<SteamAppInfoFile>();
+    opened->Open(appInfoPath);
+    path = appInfoPath;
+    stamp = current;
+    file = std::move(opened);
+    return file;
+}
+bool SteamAppInfoFile::Find(uint32_t appId, SteamAppInfo& info) const {
+    auto it = entries.find(appId);
+    if (it == entries.end()) return false;
+    BinaryKvReader reader = { mapped.data + it->second.first, mapped.data + it->second.first + it->second.second, magic == kAppInfoMagicV29 ? &keyTable : nullptr };
+    uint8_t type; std::string_view key;
+    if (!reader.Next(type, key) || type != kBinKvMap) return false;
+    // Only appinfo/common (name, type) and appinfo/config (installdir, launch) are decoded; depots and the rest are stepped over.
+    while (reader.Next(type, key)) {
+        bool common = KvKeyEquals(key, "common");
+        if (type != kBinKvMap || !(common || KvKeyEquals(key, "config"))) { reader.Skip(type); continue; }
+        while (reader.Next(type, key)) {
+            if (type == kBinKvString) {
+                std::string_view value = reader.String();
+                if (common && KvKeyEquals(key, "name")) info.name = value;
+                else if (common && KvKeyEquals(key, "type")) info.type = value;
+                else if (!common && KvKeyEquals(key, "installdir")) info.installDir = value;
+                continue;
+            }
+            if (common || type != kBinKvMap || !KvKeyEquals(key, "launch")) { reader.Skip(type); continue; }
+            while (reader.Next(type, key)) {
+                if (type != kBinKvMap) { reader.Skip(type); continue; }
+                SteamLaunchOption option;
+                while (reader.Next(type, key)) {
+                    if (type == kBinKvString) {
+                        std::string_view value = reader.String();
+                        if (KvKeyEquals(key, "executable")) option.executable = value;
+                        else if (KvKeyEquals(key, "arguments")) option.arguments = value;
+                        else if (KvKeyEquals(key, "workingdir")) option.workingDir = value;
+                        else if (KvKeyEquals(key, "type")) option.type = value;
+                        continue;
+                    }
+                    if (type != kBinKvMap || !KvKeyEquals(key, "config")) { reader.Skip(type); continue; }
+                    while (reader.Next(type, key)) {
+                        if (type != kBinKvString) { reader.Skip(type); continue; }
+                        std::string_view value = reader.String();
+                        if (KvKeyEquals(key, "oslist")) option.oslist = value;
+                        else if (KvKeyEquals(key, "osarch")) option.osarch = value;
+                        else if (KvKeyEquals(key, "BetaKey")) option.betaKey = value;
+                    }
+                }
+                info.launch.push_back(option);
+            }
+        }
+    }
+    return true;
+}
+// What "Play" runs on this PC: a Windows entry (or one for every OS) outside any beta branch, the default entry over alternates
+// such as "option1" or "server", and the 64-bit build over the 32-bit one. Ties go to the earlier entry, as in Steam's own list.
+const SteamLaunchOption* PickSteamLaunchOption(const SteamAppInfo& info) {
+    const SteamLaunchOption* best = nullptr;
+    int bestScore = -1;
+    for (const auto& option : info.launch) {
+        if (option.executable.empty() || !option.betaKey.empty()) continue;
+        if (!option.oslist.empty() && option.oslist.find("windows") == std::string_view::npos) continue;
+        bool isDefault = option.type.empty() || KvKeyEquals(option.type, "default") || KvKeyEquals(option.type, "none");
+        int score = (isDefault ? 4 : 0) + (option.osarch == "64" ? 2 : option.osarch.empty() ? 1 : 0);
+        if (score > bestScore) { best = &option; bestScore = score; }
+    }
+    return best;
+}
+#if defined(_M_X64) || defined(_M_IX86)
+// Carry-less multiplication folding ("Fast CRC Computation for Generic Polynomials Using PCLMULQDQ", Intel, 2009): four 128-bit
+// lanes fold 64 bytes per step, then fold into one lane, then Barrett-reduce to 32 bits. Takes and returns the running
+// (inverted) CRC; size is at least 64 and a multiple of 16.
+uint32_t Crc32Pclmul(uint32_t crc, const uint8_t* data, size_t size) {
+    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4), k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+    const __m128i k5 = _mm_set_epi64x(0, 0x0163cd6124), poly = _mm_set_epi64x(0x01f7011641, 0x01db710641), low32 = _mm_setr_epi32(-1, 0, -1, 0);
+    auto load = [](const uint8_t* at) { return _mm_loadu_si128((const __m128i*)at); };
+    auto fold = [](__m128i lane, __m128i k, __m128i next) {
+        return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(lane, k, 0x00), _mm_clmulepi64_si128(lane, k, 0x11)), next);
+    };
+    __m128i x1 = _mm_xor_si128(load(data), _mm_cvtsi32_si128((int)crc)), x2 = load(data + 16), x3 = load(data + 32), x4 = load(data + 48);
+    data += 64; size -= 64;
+    for (; size >= 64; data += 64, size -= 64) {
+        x1 = fold(x1, k1k2, load(data)); x2 = fold(x2, k1k2, load(data + 16));
+        x3 = fold(x3, k1k2, load(data + 32)); x4 = fold(x4, k1k2, load(data + 48));
+    }
+    x1 = fold(fold(fold(x1, k3k4, x2), k3k4, x3), k3k4, x4);
+    for (; size >= 16; data += 16, size -= 16) x1 = fold(x1, k3k4, load(data));
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), _mm_clmulepi64_si128(x1, k3k4, 0x10));
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 4), _mm_clmulepi64_si128(_mm_and_si128(x1, low32), k5, 0x00));
+    __m128i reduced = _mm_clmulepi64_si128(_mm_and_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, low32), poly, 0x10), low32), poly, 0x00);
+    return (uint32_t)_mm_extract_epi32(_mm_xor_si128(x1, reduced), 1);
+}
+#endif
+// Bulk data goes through Crc32Pclmul when CPUID reports PCLMULQDQ and SSE4.1; the table loop takes the tail and older CPUs.
+uint32_t Crc32(uint32_t crc, const void* data, size_t size) {
+    static const auto table = [] {
+        std::vector<uint32_t> entries(256);
+        for (uint32_t i = 0; i < 256; i++) { uint32_t c = i; for (int k = 0; k < 8; k++) c = (c >> 1) ^ (0xEDB88320 & (0u - (c & 1))); entries[i] = c; }
+        return entries;
+    }();
+    const uint8_t* bytes = (const uint8_t*)data;
+    crc = ~crc;
+#if defined(_M_X64) || defined(_M_IX86)
+    static const bool pclmul = [] { int info[4]; __cpuid(info, 1); return (info[2] & (1 << 1)) && (info[2] & (1 << 19)); }();
+    if (pclmul && size >= 64) {
+        size_t bulk = size & ~(size_t)15;
+        crc = Crc32Pclmul(crc, bytes, bulk);
+        bytes += bulk; size -= bulk;
+    }
+#endif
+    for (size_t i = 0; i < size; i++) crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+void ReadSteamShortcuts(const std::wstring& userDir, std::vector<Game>& games) {
+    std::string data;
+    if (!ReadFileBytes(userDir + L"\\config\\shortcuts.vdf", data)) return;
+    // One listing of config\grid answers the artwork lookups for every shortcut, however many thousands there are.
+    std::wstring gridDir = userDir + L"\\config\\grid";
+    std::unordered_set<std::wstring> gridFiles;
+    DirectoryReader grid;
+    DirEntry entry;
+    if (grid.Open(gridDir)) while (grid.Next(entry)) if (!entry.isDirectory) gridFiles.insert(entry.name);
+    BinaryKvReader reader = { (const uint8_t*)data.data(), (const uint8_t*)data.data() + data.size() };
+    uint8_t type; std::string_view key;
+    if (!reader.Next(type, key) || type != kBinKvMap || !KvKeyEquals(key, "shortcuts")) return;
+    while (reader.Next(type, key)) {
+        if (type != kBinKvMap) { reader.Skip(type); continue; }
+        std::string_view name, exe, startDir, launchOptions;
+        uint32_t appId = 0, hidden = 0;
+        while (reader.Next(type, key)) {
+            if (type == kBinKvString) {
+                std::string_view value = reader.String();
+                if (KvKeyEquals(key, "AppName")) name = value;
+                else if (KvKeyEquals(key, "Exe")) exe = value;
+                else if (KvKeyEquals(key, "StartDir")) startDir = value;
+                else if (KvKeyEquals(key, "LaunchOptions")) launchOptions = value;
+            }
+            else if (type == kBinKvInt32) {
+                uint32_t value = reader.Int32();
+                if (KvKeyEquals(key, "appid")) appId = value;
+                else if (KvKeyEquals(key, "IsHidden")) hidden = value;
+            }
+            else reader.Skip(type);
+        }
+        if (name.empty() || exe.empty() || hidden) continue;
+        // Older files carry no appid; Steam derives it from the quoted exe followed by the name.
+        if (appId == 0) appId = Crc32(Crc32(0, exe.data(), exe.size()), name.data(), name.size()) | 0x80000000;
+        auto unquote = [](std::string_view text) { return (text.size() >= 2 && text.front() == '"' && text.back() == '"') ? text.substr(1, text.size() - 2) : text; };
+        Game game;
+        game.name = Utf8ToWide(name);
+        game.path = Utf8ToWide(unquote(exe));
+        game.appId = std::to_wstring(appId);
+        game.source = L"steam-shortcut";
+        game.launchOptions = Utf8ToWide(launchOptions);
+        game.startDir = Utf8ToWide(unquote(startDir));
+        for (const wchar_t* suffix : { L"p.png", L"p.jpg", L".png", L".jpg" }) {
+            std::wstring file = game.appId + suffix;
+            if (gridFiles.count(file)) { game.art = gridDir + L"\\" + file; break; }
+        }
+        games.push_back(game);
+    }
+}
+// Epic Games Launcher keeps one JSON .item manifest per install in the Manifests folder of its data folder (normally
+// C:\ProgramData\Epic\EpicLauncher\Data). Each names the install folder and the exe inside it, so nothing has to be searched for.
+void FindEpicGames(ProviderRun& run) {
+    std::wstring dataPath = g_registry.ReadString(L"HKEY_LOCAL_MACHINE\\SOFTWARE\\Epic Games\\EpicLauncher", L"AppDataPath", KEY_WOW64_32KEY);
+    if (dataPath.empty()) {
+        std::wstring programData = GetProgramDataPath();
+        if (programData.empty()) return;
+        dataPath = programData + L"\\Epic\\EpicLauncher\\Data";
+    }
+    while (!dataPath.empty() && dataPath.back() == L'\\') dataPath.pop_back();
+    std::wstring manifestDir = dataPath + L"\\Manifests";
+    std::vector<std::wstring> manifests;
+    DirectoryReader reader;
+    DirEntry entry;
+    if (!reader.Open(manifestDir)) return;
+    while (reader.Next(entry)) {
+        size_t length = wcslen(entry.name);
+        if (!entry.isDirectory && length > 5 && _wcsicmp(entry.name + length - 5, L".item") == 0) manifests.push_back(manifestDir + L"\\" + entry.name);
+    }
+    std::vector<Game> games(manifests.size());
+    g_workerPool.ParallelFor(manifests.size(), [&](size_t i) { if (!run.cancelled) ReadEpicManifest(manifests[i], games[i]); });
+    for (const auto& game : games) if (!game.path.empty()) run.games.push_back(game);
+}
+// Leaves game empty for an install that is unfinished, is not a game (see EpicManifest) or whose exe is missing.
+bool ReadEpicManifest(const std::wstring& path, Game& game) {
+    std::string data;
+    EpicManifest manifest;
+    if (!ReadFileBytes(path, data) || !ParseEpicManifest(data, manifest)) return false;
+    if (manifest.incomplete || !manifest.isGame || manifest.exePath.empty()) return true;
+    DWORD attributes = GetFileAttributesW(manifest.exePath.c_str());
+    if (attributes == INVALID_FILE_ATTRIBUTES || (attributes & FILE_ATTRIBUTE_DIRECTORY)) return true;
+    game.name = manifest.displayName.empty() ? manifest.appName : manifest.displayName;
+    game.path = manifest.exePath;
+    game.appId = manifest.appName;
+    game.sizeOnDisk = manifest.installSize;
+    game.source = L"epic";
+    game.launchOptions = manifest.launchCommand;
+    return true;
+}
+bool ParseEpicManifest(std::string_view data, EpicManifest& manifest) {
+    std::string_view installLocation, launchExecutable, mainGameAppName, categories;
+    bool executable = true;
+    bool parsed = StreamJsonObject(data, [&](std::string_view key, std::string_view value) {
+        if (key == "DisplayName") manifest.displayName = JsonToWide(value);
+        else if (key == "InstallLocation") installLocation = value;
+        else if (key == "LaunchExecutable") launchExecutable = value;
+        else if (key == "LaunchCommand") manifest.launchCommand = JsonToWide(value);
+        else if (key == "AppName") manifest.appName = JsonToWide(value);
+        else if (key == "MainGameAppName") mainGameAppName = value;
+        else if (key == "InstallSize") manifest.installSize = ParseUint(value);
+        else if (key == "AppCategories") categories = value;
+        else if (key == "bIsIncompleteInstall") manifest.incomplete = value == "true";
+        else if (key == "bIsExecutable") executable = value != "false";
+    });
+    if (!parsed) return false;
+    manifest.isGame = executable && (categories.empty() || categories.find("\"games\"") != std::string_view::npos)
+        && (mainGameAppName.empty() || JsonToWide(mainGameAppName) == manifest.appName);
+    std::wstring location = JsonToWide(installLocation), exe = JsonToWide(launchExecutable);
+    if (location.empty() || exe.empty()) return true;
+    std::replace(exe.begin(), exe.end(), L'/', L'\\');
+    while (!location.empty() && (location.back() == L'\\' || location.back() == L'/')) location.pop_back();
+    size_t skip = 0;
+    while (skip < exe.size() && exe[skip] == L'\\') skip++;
+    manifest.exePath = location + L"\\" + exe.substr(skip);
+    return true;
+}
+// GOG installs are listed under GOG.com\Games in the registry by the installers and in Galaxy 2.0's database by the client;
+// either may know folders the other does not. Every game folder holds goggame-<id>.info, whose primary play task is the exact
+// exe and arguments GOG launches, so folders are never searched. Folders resolved here are claimed, which keeps the guesses
+// FindRegistryGames makes from their Uninstall entries out of the library (see MergeProviderRuns).
+void FindGogGames(ProviderRun& run) {
+    std::vector<GogInstall> installs;
+    std::vector<RegistrySubkey> subkeys;
+    const std::wstring gamesKey = L"HKEY_LOCAL_MACHINE\\SOFTWARE\\GOG.com\\Games";
+    g_registry.ListSubkeys(gamesKey, subkeys, KEY_WOW64_32KEY);
+    for (const auto& subkey : subkeys) {
+        std::vector<RegistryValue> values;
+        if (!g_registry.ReadValues(gamesKey + L"\\" + subkey.name, { L"path", L"gameName", L"gameID", L"exe", L"launchParam", L"workingDir" }, values, KEY_WOW64_32KEY)) continue;
+        installs.push_back({values[0].text, values[1].text, values[2].text.empty() ? subkey.name : values[2].text, values[3].text, values[4].text, values[5].text});
+    }
+    std::wstring programData = GetProgramDataPath();
+    if (!programData.empty()) ReadGalaxyInstalls(programData + L"\\GOG.com\\Galaxy\\storage\\galaxy-2.0.db", installs);
+    std::unordered_set<std::wstring> folders;
+    std::vector<size_t> unique;
+    for (size_t i = 0; i < installs.size(); i++) if (!installs[i].folder.empty() && folders.insert(NormalizePathKey(installs[i].folder)).second) unique.push_back(i);
+    std::vector<Game> games(unique.size());
+    g_workerPool.ParallelFor(unique.size(), [&](size_t i) { if (!run.cancelled) ResolveGogInstall(installs[unique[i]], games[i]); });
+    for (size_t i = 0; i < unique.size(); i++) {
+        if (games[i].path.empty()) continue;
+        run.claims.push_back(installs[unique[i]].folder);
+        run.games.push_back(games[i]);
+    }
+}
+// Galaxy 2.0 keeps its library in SQLite. Windows ships the engine as winsqlite3.dll, so it is loaded from System32 at run time
+// rather than linked. One read-only query fetches every installed product with its title; without the DLL, or with a schema
+// it does not recognise, the registry's list is used alone.
+bool ReadGalaxyInstalls(const std::wstring& dbPath, std::vector<GogInstall>& installs) {
+    if (GetFileAttributesW(dbPath.c_str()) == INVALID_FILE_ATTRIBUTES) return false;
+    HMODULE sqlite = LoadLibraryExW(L"winsqlite3.dll", nullptr, LOAD_LIBRARY_SEARCH_SYSTEM32);
+    if (!sqlite) return false;
+    typedef int (WINAPI* OpenFn)(const char*, void**, int, const char*);
+    typedef int (WINAPI* PrepareFn)(void*, const char*, int, void**, const char**);
+    typedef int (WINAPI* StatementFn)(void*);
+    typedef const void* (WINAPI* ColumnTextFn)(void*, int);
+    typedef int (WINAPI* CloseFn)(void*);
+    const int kSqliteOpenReadOnly = 0x1, kSqliteOk = 0, kSqliteRow = 100;
+    auto open = (OpenFn)GetProcAddress(sqlite, "sqlite3_open_v2");
+    auto prepare = (PrepareFn)GetProcAddress(sqlite, "sqlite3_prepare_v2");
+    auto step = (StatementFn)GetProcAddress(sqlite, "sqlite3_step"), finalize = (StatementFn)GetProcAddress(sqlite, "sqlite3_finalize");
+    auto columnText = (ColumnTextFn)GetProcAddress(sqlite, "sqlite3_column_text16");
+    auto close = (CloseFn)GetProcAddress(sqlite, "sqlite3_close");
+    bool read = false;
+    void* db = nullptr;
+    if (open && prepare && step && finalize && columnText && close) {
+        if (open(WideToUtf8(dbPath).c_str(), &db, kSqliteOpenReadOnly, nullptr) == kSqliteOk) {
+            void* statement = nullptr;
+            const char* query = "SELECT p.productId, p.installationPath, (SELECT d.title FROM LimitedDetails d WHERE d.productId = p.productId LIMIT 1) FROM InstalledBaseProducts p";
+            if (prepare(db, query, -1, &statement, nullptr) == kSqliteOk) {
+                auto text = [&](int column) { const wchar_t* value = (const wchar_t*)columnText(statement, column); return std::wstring(value ? value : L""); };
+                while (step(statement) == kSqliteRow) installs.push_back({text(1), text(2), text(0)});
+                read = true;
+            }
+            finalize(statement);
+        }
+        close(db); // Closes a handle a failed open still hands back, too
+    }
+    FreeLibrary(sqlite);
+    return read;
+}
+// The info file named for the install's game comes first: DLC folders merged into a game's folder bring their own info files,
+// which carry no primary play task.
+bool ResolveGogInstall(const GogInstall& install, Game& game) {
+    std::wstring folder = install.folder;
+    while (!folder.empty() && (folder.back() == L'\\' || folder.back() == L'/')) folder.pop_back();
+    bool found = !install.gameId.empty() && ReadGogInfo(folder + L"\\goggame-" + install.gameId + L".info", folder, game);
+    DirectoryReader reader;
+    DirEntry entry;
+    if (!found && reader.Open(folder))
+        while (!found && reader.Next(entry)) {
+            size_t length = wcslen(entry.name);
+            if (!entry.isDirectory && length > 13 && _wcsnicmp(entry.name, L"goggame-", 8) == 0 && _wcsicmp(entry.name + length - 5, L".info") == 0)
+                found = ReadGogInfo(folder + L"\\" + entry.name, folder, game);
+        }
+    if (!found && !install.exe.empty()) {
+        DWORD attributes = GetFileAttributesW(install.exe.c_str());
+        if (attributes != INVALID_FILE_ATTRIBUTES && !(attributes & FILE_ATTRIBUTE_DIRECTORY)) {
+            game = {install.name, install.exe, install.gameId};
+            game.launchOptions = install.arguments;
+            game.startDir = install.workingDir;
+            found = true;
+        }
+    }
+    if (!found) return false;
+    if (game.name.empty()) game.name = install.name;
+    if (game.appId.empty()) game.appId = install.gameId;
+    game.source = L"gog";
+    return true;
+}
+// The play task GOG launches is the primary FileTask; URL tasks (manuals, forums) and secondary tools are skipped.
+bool ReadGogInfo(const std::wstring& path, const std::wstring& folder, Game& game) {
+    std::string data;
+    if (!ReadFileBytes(path, data)) return false;
+    std::string_view name, gameId, tasks;
+    StreamJsonObject(data, [&](std::string_view key, std::string_view value) {
+        if (key == "name") name = value;
+        else if (key == "gameId") gameId = value;
+        else if (key == "playTasks") tasks = value;
+    });
+    std::string_view exe, arguments, workingDir;
+    StreamJsonArray(tasks, [&](std::string_view task) {
+        std::string_view taskPath, taskArguments, taskWorkingDir, type, category;
+        bool primary = false;
+        StreamJsonObject(task, [&](std::string_view key, std::string_view value) {
+            if (key == "path") taskPath = value;
+            else if (key == "arguments") taskArguments = value;
+            else if (key == "workingDir") taskWorkingDir = value;
+            else if (key == "type") type = value;
+            else if (key == "category") category = value;
+            else if (key == "isPrimary") primary = value == "true";
+        });
+        if (exe.empty() && primary && type == "\"FileTask\"" && (category.empty() || category == "\"game\"")) { exe = taskPath; arguments = taskArguments; workingDir = taskWorkingDir; }
+    });
+    // Task paths are relative to the install folder, with either slash.
+    auto inFolder = [&folder](std::string_view relative) {
+        std::wstring path = JsonToWide(relative);
+        std::replace(path.begin(), path.end(), L'/', L'\\');
+        size_t skip = path.rfind(L".\\", 0) == 0 ? 2 : 0;
+        while (skip < path.size() && path[skip] == L'\\') skip++;
+        return folder + L"\\" + path.substr(skip);
+    };
+    if (exe.empty()) return false;
+    std::wstring exePath = inFolder(exe);
+    DWORD attributes = GetFileAttributesW(exePath.c_str());
+    if (attributes == INVALID_FILE_ATTRIBUTES || (attributes & FILE_ATTRIBUTE_DIRECTORY)) return false;
+    game = {JsonToWide(name), exePath, JsonToWide(gameId)};
+    game.launchOptions = JsonToWide(arguments);
+    if (!workingDir.empty()) game.startDir = inFolder(workingDir);
+    return true;
+}
+// Battle.net records each installed product's folder in product.db but not its exe, so that is found with the usual cached
+// search, named after the install folder. Blizzard versions end in the build number, which becomes the game's buildId.
+// Folders resolved here are claimed, like GOG's, ahead of their Uninstall entries.
+void FindBattleNetGames(ProviderRun& run) {
+    std::wstring programData = GetProgramDataPath();
+    MappedFile db;
+    if (programData.empty() || !db.Open(programData + L"\\Battle.net\\Agent\\product.db")) return;
+    std::vector<BattleNetProduct> products;
+    ReadBattleNetProducts(db.data, db.size, products);
+    std::vector<Game> games;
+    std::vector<std::wstring> installFolders;
+    std::unordered_set<std::wstring> folders;
+    for (const auto& product : products) {
+        // "agent" and "bna" are the Battle.net client itself.
+        if (!product.installed || product.installPath.empty() || product.code == "agent" || product.code == "bna") continue;
+        std::wstring folder = Utf8ToWide(product.installPath);
+        std::replace(folder.begin(), folder.end(), L'/', L'\\');
+        while (folder.size() > 3 && folder.back() == L'\\') folder.pop_back();
+        if (!folders.insert(NormalizePathKey(folder)).second) continue;
+        // Installed but not playable: the agent is mid-install, updating or repairing it. Claimed so no Uninstall guess shows it either.
+        if (!product.playable) { run.claims.push_back(folder); continue; }
+        Game game;
+        game.name = folder.substr(folder.rfind(L'\\') + 1);
+        game.appId = Utf8ToWide(product.code);
+        size_t dot = product.version.rfind('.');
+        game.buildId = (uint32_t)ParseUint(product.version.substr(dot == std::string_view::npos ? 0 : dot + 1));
+        game.source = L"battlenet";
+        games.push_back(std::move(game));
+        installFolders.push_back(folder);
+    }
+    g_workerPool.ParallelFor(games.size(), [&](size_t i) { if (!run.cancelled) games[i].path = ResolveExecutable(installFolders[i], games[i].name); });
+    for (size_t i = 0; i < games.size(); i++) {
+        if (games[i].path.empty()) continue;
+        run.claims.push_back(installFolders[i]);
+        run.games.push_back(games[i]);
+    }
+}
+// ROMs listed by roms.txt (see RomSystem), launched through their emulator. Archives are identified from the CRCs in their
+// directory, disc images by the serial in their headers, and other files (images without one too) are hashed, but only when
+// the system has a DAT to match against; results are cached per ROM file and DAT, so later scans read only new or changed ROMs.
+void FindRomGames(ProviderRun& run) {
+    std::vector<RomSystem> systems;
+    ReadRomSystems(GetExecutablePath() + L"\\roms.txt", systems);
+    if (systems.empty()) return;
+    std::vector<RomDat> dats(systems.size());
+    std::vector<std::vector<RomFile>> listed(systems.size());
+    g_workerPool.ParallelFor(systems.size(), [&](size_t i) {
+        if (!systems[i].datPath.empty()) dats[i].Load(systems[i].datPath);
+        ListRomFiles(systems[i], i, listed[i]);
+    });
+    std::vector<RomFile> files;
+    for (auto& system : listed) std::move(system.begin(), system.end(), std::back_inserter(files));
+    RomScanStats stats;
+    auto start = std::chrono::steady_clock::now();
+    g_workerPool.ParallelFor(files.size(), [&](size_t i) { if (!run.cancelled) IdentifyRom(files[i], dats[files[i].system], stats); else files[i].stored = false; });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    wchar_t line[200];
+    swprintf(line, 200, L"WinDeck Nexus: identified %zu ROMs, hashed %.1f MB at %.0f MB/s, read %.1f KB from %llu disc images\n", files.size(), stats.hashedBytes / 1e6,
+        seconds > 0 ? stats.hashedBytes / 1e6 / seconds : 0.0, stats.discBytes / 1e3, (unsigned long long)stats.discs);
+    OutputDebugStringW(line);
+    for (const auto& file : files) {
+        if (!file.stored) continue;
+        const RomSystem& system = systems[file.system];
+        Game identity;
+        identity.name = file.name; identity.path = file.path; identity.appId = RomAppId(file); identity.source = L"rom";
+        g_scanCache.Store(file.path + L"|" + std::to_wstring(dats[file.system].stamp.mtime), file.stamp, identity);
+        Game game;
+        game.name = file.name;
+        game.path = system.emulator;
+        game.appId = RomAppId(file);
+        game.sizeOnDisk = file.stamp.size;
+        game.source = L"rom";
+        game.startDir = system.emulator.substr(0, system.emulator.rfind(L'\\'));
+        game.launchOptions = system.arguments;
+        for (size_t at = 0; (at = game.launchOptions.find(L"{rom}", at)) != std::wstring::npos; at += file.path.size()) game.launchOptions.replace(at, 5, file.path);
+        run.games.push_back(std::move(game));
+    }
+}
+void ReadRomSystems(const std::wstring& path, std::vector<RomSystem>& systems) {
+    ReadFieldLines(path, [&](const std::vector<std::wstring_view>& fields) {
+        if (fields.size() < 2 || fields[0].empty() || fields[1].empty()) return;
+        RomSystem system;
+        system.folder = fields[0];
+        system.emulator = fields[1];
+        system.arguments = fields.size() > 2 && !fields[2].empty() ? std::wstring(fields[2]) : L"\"{rom}\"";
+        if (fields.size() > 3) for (size_t from = 0, comma; from < fields[3].size(); from = comma + 1) {
+            comma = std::min(fields[3].find(L',', from), fields[3].size());
+            std::wstring_view extension = fields[3].substr(from, comma - from);
+            while (!extension.empty() && iswspace(extension.back())) extension.remove_suffix(1);
+            while (!extension.empty() && (iswspace(extension.front()) || extension.front() == L'.')) extension.remove_prefix(1);
+            if (!extension.empty()) system.extensions.push_back(FoldAscii(extension));
+        }
+        if (fields.size() > 4) system.datPath = fields[4];
+        systems.push_back(std::move(system));
+    });
+}
+// Each line of a |-separated config file (roms.txt, playlists.txt) as its trimmed fields. Blank lines and # comments are skipped.
+void ReadFieldLines(const std::wstring& path, const std::function<void(const std::vector<std::wstring_view>&)>& onLine) {
+    std::string data;
+    if (!ReadFileBytes(path, data)) return;
+    std::wstring text = Utf8ToWide(data);
+    auto trim = [](std::wstring_view field) {
+        while (!field.empty() && iswspace(field.back())) field.remove_suffix(1);
+        while (!field.empty() && (iswspace(field.front()) || field.front() == 0xFEFF)) field.remove_prefix(1);
+        return field;
+    };
+    std::vector<std::wstring_view> fields;
+    for (size_t start = 0, end; start < text.size(); start = end + 1) {
+        end = std::min(text.find(L'\n', start), text.size());
+        std::wstring_view line = trim(std::wstring_view(text).substr(start, end - start));
+        if (line.empty() || line.front() == L'#') continue;
+        fields.clear();
+        for (size_t from = 0, bar; from <= line.size(); from = bar + 1) {
+            bar = std::min(line.find(L'|', from), line.size());
+            fields.push_back(trim(line.substr(from, bar - from)));
+        }
+        onLine(fields);
+    }
+}
+// Art, saves, notes and the DATs themselves, skipped when a system names no extensions.
+const wchar_t* const kRomSideExtensions[] = { L"txt", L"nfo", L"dat", L"xml", L"jpg", L"jpeg", L"png", L"gif", L"pdf", L"srm", L"sav", L"state",
+    L"cfg", L"ini", L"db", L"url", L"lnk", L"exe", L"dll" };
+// Sheets that stand for a multi-file game: a CD's tracks (.cue), a Dreamcast GD-ROM's (.gdi) or a multi-disc set (.m3u).
+const wchar_t* const kRomSheetExtensions[] = { L"cue", L"gdi", L"m3u" };
+void ListRomFiles(const RomSystem& system, size_t index, std::vector<RomFile>& files) {
+    std::vector<std::pair<std::wstring, size_t>> pending = {{system.folder, 0}};
+    while (!pending.empty()) {
+        auto [dir, depth] = std::move(pending.back());
+        pending.pop_back();
+        DirectoryReader reader;
+        DirEntry entry;
+        if (!reader.Open(dir)) continue;
+        while (reader.Next(entry)) {
+            if (entry.isDirectory) { if (!entry.isReparsePoint && depth < kRomSearchDepth) pending.push_back({dir + L"\\" + entry.name, depth + 1}); continue; }
+            const wchar_t* dot = wcsrchr(entry.name, L'.');
+            std::wstring extension = dot ? FoldAscii(dot + 1) : L"";
+            bool listedExtension = std::find(system.extensions.begin(), system.extensions.end(), extension) != system.extensions.end();
+            bool sideFile = std::any_of(std::begin(kRomSideExtensions), std::end(kRomSideExtensions), [&](const wchar_t* side) { return extension == side; });
+            if (system.extensions.empty() ? sideFile : !listedExtension) continue;
+            RomFile file;
+            file.path = dir + L"\\" + entry.name;
+            file.stamp = {entry.mtime, entry.size};
+            file.system = index;
+            files.push_back(std::move(file));
+        }
+    }
+    // A sheet (kRomSheetExtensions) is the game: the tracks or discs it names are neither shown nor identified on their own.
+    std::unordered_set<std::wstring> named;
+    std::vector<std::wstring> names;
+    for (const auto& file : files) {
+        std::wstring extension = FoldAscii(std::wstring_view(file.path).substr(file.path.rfind(L'.') + 1));
+        if (!std::any_of(std::begin(kRomSheetExtensions), std::end(kRomSheetExtensions), [&](const wchar_t* sheet) { return extension == sheet; })) continue;
+        std::string text;
+        if (file.stamp.size > kRomSheetMaxBytes || !ReadFileBytes(file.path, text)) continue;
+        names.clear();
+        ReadRomSheet(text, extension, names);
+        std::wstring dir = file.path.substr(0, file.path.rfind(L'\\') + 1);
+        for (auto& name : names) {
+            std::replace(name.begin(), name.end(), L'/', L'\\');
+            named.insert(NormalizePathKey(name.find(L':') != std::wstring::npos ? name : dir + name));
+        }
+    }
+    if (!named.empty()) files.erase(std::remove_if(files.begin(), files.end(), [&](const RomFile& file) { return named.count(NormalizePathKey(file.path)) != 0; }), files.end());
+}
+// The files a sheet names, as written: a cue sheet's FILE lines, a GD-ROM .gdi's track lines (number, sector, type, sector
+// size, file, offset) and every line of an .m3u disc list but # comments. Names may be quoted when they hold spaces.
+void ReadRomSheet(std::string_view text, std::wstring_view extension, std::vector<std::wstring>& names) {
+    if (text.rfind("\xEF\xBB\xBF", 0) == 0) text.remove_prefix(3);
+    auto token = [](std::string_view line, size_t& at) {
+        while (at < line.size() && (line[at] == ' ' || line[at] == '\t')) at++;
+        if (at == line.size()) return std::string_view();
+        size_t end = line[at] == '"' ? line.find('"', at + 1) : line.find_first_of(" \t", at);
+        if (end == std::string_view::npos) end = line.size();
+        std::string_view field = line[at] == '"' ? line.substr(at + 1, end - at - 1) : line.substr(at, end - at);
+        at = std::min(end + 1, line.size());
+        return field;
+    };
+    for (size_t start = 0, end; start < text.size(); start = end + 1) {
+        end = std::min(text.find('\n', start), text.size());
+        std::string_view line = text.substr(start, end - start);
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t')) line.remove_suffix(1);
+        while (!line.empty() && (line.front() == ' ' || line.front() == '\t')) line.remove_prefix(1);
+        if (line.empty()) continue;
+        std::string_view name;
+        if (extension == L"m3u") { if (line.front() != '#') name = line; }
+        else if (extension == L"cue") {
+            size_t at = 0;
+            if (KvKeyEquals(token(line, at), "FILE")) name = token(line, at);
+        }
+        else {
+            size_t at = 0;
+            std::string_view fields[5];
+            for (auto& field : fields) field = token(line, at);
+            if (IsAsciiDigits(fields[0]) && IsAsciiDigits(fields[3])) name = fields[4];
+        }
+        if (!name.empty()) names.push_back(Utf8ToWide(name));
+    }
+}
+// Disc images (kDiscExtensions) are identified by the serial in their headers, which costs a few sectors rather than hashing
+// gigabytes. One without a serial is hashed like any ROM: Mega Drive and Atari cartridges are dumped as .bin too, and Redump
+// DATs list each track's CRC. Compressed containers (kDiscContainerExtensions) never are, as no DAT lists their CRC.
+const wchar_t* const kDiscExtensions[] = { L"iso", L"bin", L"cue", L"img", L"gcm", L"rvz", L"wia", L"chd" };
+const wchar_t* const kDiscContainerExtensions[] = { L"rvz", L"wia", L"chd" };
+const wchar_t kRomSerialTag[] = L"serial:";
+void IdentifyRom(RomFile& file, const RomDat& dat, RomScanStats& stats) {
+    Game cached;
+    if (g_scanCache.Lookup(file.path + L"|" + std::to_wstring(dat.stamp.mtime), file.stamp, cached)) {
+        file.name = cached.name;
+        if (cached.appId.rfind(kRomSerialTag, 0) == 0) file.serial = cached.appId.substr(wcslen(kRomSerialTag));
+        else file.crc = cached.appId;
+        return;
+    }
+    size_t slash = file.path.rfind(L'\\'), dot = file.path.rfind(L'.');
+    if (dot == std::wstring::npos || dot < slash) dot = file.path.size();
+    std::wstring extension = FoldAscii(std::wstring_view(file.path).substr(std::min(dot + 1, file.path.size())));
+    std::wstring stem = file.path.substr(slash + 1, dot - slash - 1);
+    auto listed = [&extension](const auto& extensions) { return std::any_of(std::begin(extensions), std::end(extensions), [&](const wchar_t* listed) { return extension == listed; }); };
+    const std::wstring* name = nullptr;
+    uint32_t crc = 0;
+    bool known = false;
+    if (listed(kDiscExtensions)) {
+        DiscInfo disc;
+        uint64_t bytes = 0;
+        bool read = ReadDiscInfo(file.path, extension, disc, bytes);
+        stats.discBytes += bytes;
+        stats.discs++;
+        if (read || listed(kDiscContainerExtensions)) {
+            if (read) {
+                file.serial = Utf8ToWide(disc.serial);
+                name = dat.FindSerial(disc.serial);
+                if (!name && !disc.title.empty()) name = &disc.title;
+            }
+            file.name = name ? *name : stem;
+            return;
+        }
+    }
+    if (extension == L"zip" || extension == L"7z") {
+        MappedFile archive;
+        std::vector<ArchiveMember> members;
+        if (archive.Open(file.path) && (extension == L"zip" ? ReadZipMembers : Read7zMembers)(archive.data, archive.size, members) && !members.empty()) {
+            crc = members[0].crc;
+            known = true;
+            for (const auto& member : members) if ((name = dat.Find(member.crc, member.size))) { crc = member.crc; break; }
+        }
+    }
+    else if (!dat.roms.empty()) {
+        uint64_t bytes = 0;
+        known = HashFileCrc32(file.path, crc, bytes);
+        stats.hashedBytes += bytes;
+        if (known) name = dat.Find(crc, file.stamp.size);
+    }
+    if (known) { wchar_t hex[9]; swprintf(hex, 9, L"%08x", crc); file.crc = hex; }
+    file.name = name ? *name : stem;
+}
+// The appId a ROM goes by: its CRC32 in hex, or kRomSerialTag and a disc's serial, so the two never read as each other.
+std::wstring RomAppId(const RomFile& file) { return file.serial.empty() ? file.crc : kRomSerialTag + file.serial; }
+// Games already curated in RetroArch playlists and ES-DE gamelists (see PlaylistSource). Each list is walked in place over a
+// mapped file and only the entry being read is held, so a list of tens of thousands of entries costs its games and no more.
+// Entries are taken as listed; their files are not checked.
+void FindPlaylistGames(ProviderRun& run) {
+    std::vector<PlaylistSource> sources, lists;
+    ReadPlaylistSources(GetExecutablePath() + L"\\playlists.txt", sources);
+    for (auto& source : sources) {
+        DWORD attributes = GetFileAttributesW(source.list.c_str());
+        if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_DIRECTORY)) { lists.push_back(std::move(source)); continue; }
+        DirectoryReader reader;
+        DirEntry entry;
+        if (!reader.Open(source.list)) continue;
+        while (reader.Next(entry)) {
+            const wchar_t* dot = wcsrchr(entry.name, L'.');
+            if (entry.isDirectory || !dot || FoldAscii(dot + 1) != L"lpl") continue;
+            PlaylistSource list = source;
+            list.list += L"\\";
+            list.list += entry.name;
+            lists.push_back(std::move(list));
+        }
+    }
+    std::vector<std::vector<Game>> found(lists.size());
+    g_workerPool.ParallelFor(lists.size(), [&](size_t i) { (lists[i].retroArch ? ReadRetroArchPlaylist : ReadGamelist)(lists[i], run.cancelled, found[i]); });
+    for (auto& games : found) std::move(games.begin(), games.end(), std::back_inserter(run.games));
+}
+void ReadPlaylistSources(const std::wstring& path, std::vector<PlaylistSource>& sources) {
+    ReadFieldLines(path, [&](const std::vector<std::wstring_view>& fields) {
+        if (fields.empty() || fields[0].empty()) return;
+        PlaylistSource source;
+        source.list = fields[0];
+        while (source.list.size() > 3 && (source.list.back() == L'\\' || source.list.back() == L'/')) source.list.pop_back();
+        size_t slash = source.list.rfind(L'\\'), dot = source.list.rfind(L'.');
+        std::wstring extension = dot != std::wstring::npos && (slash == std::wstring::npos || dot > slash) ? FoldAscii(std::wstring_view(source.list).substr(dot + 1)) : L"";
+        source.retroArch = extension != L"xml";
+        // The folder the list lives in; for RetroArch, its playlists folder.
+        std::wstring folder = source.retroArch && extension != L"lpl" ? source.list : source.list.substr(0, slash == std::wstring::npos ? 0 : slash);
+        source.emulator = fields.size() > 1 && !fields[1].empty() ? std::wstring(fields[1])
+            : source.retroArch ? folder.substr(0, folder.rfind(L'\\') + 1) + L"retroarch.exe" : L"";
+        if (source.emulator.empty()) return;
+        source.arguments = fields.size() > 2 && !fields[2].empty() ? std::wstring(fields[2]) : source.retroArch ? L"-L \"{core}\" \"{rom}\"" : L"\"{rom}\"";
+        source.romFolder = fields.size() > 3 && !fields[3].empty() ? std::wstring(fields[3]) : folder;
+        sources.push_back(std::move(source));
+    });
+}
+// RetroArch's JSON playlist (1.7.6 and later): entries under "items" with path, label, core_path and crc32 ("1234ABCD|crc"),
+// and a default_core_path for entries whose core is DETECT. A path starting with ":\" is relative to RetroArch's folder.
+void ReadRetroArchPlaylist(const PlaylistSource& source, const std::atomic<bool>& cancelled, std::vector<Game>& games) {
+    MappedFile file;
+    if (!file.Open(source.list)) return;
+    std::string_view items;
+    std::wstring defaultCore;
+    StreamJsonObject(std::string_view((const char*)file.data, file.size), [&](std::string_view key, std::string_view value) {
+        if (key == "items") items = value;
+        else if (key == "default_core_path") defaultCore = JsonToWide(value);
+    });
+    std::wstring home = source.emulator.substr(0, std::min(source.emulator.rfind(L'\\'), source.emulator.size()));
+    auto expand = [&home](std::wstring path) {
+        if (path.size() > 1 && path[0] == L':' && (path[1] == L'\\' || path[1] == L'/')) path.replace(0, 1, home);
+        return path;
+    };
+    StreamJsonArray(items, [&](std::string_view item) {
+        if (cancelled) return;
+        std::wstring path, label, core, crc;
+        StreamJsonObject(item, [&](std::string_view key, std::string_view value) {
+            if (key == "path") path = JsonToWide(value);
+            else if (key == "label") label = JsonToWide(value);
+            else if (key == "core_path") core = JsonToWide(value);
+            else if (key == "crc32") crc = JsonToWide(value);
+        });
+        if (core.empty() || core == L"DETECT") core = defaultCore;
+        Game game;
+        if (path.empty() || !MakePlaylistGame(source, label, ResolveListPath(source.romFolder, expand(path)), core.empty() ? core : expand(core), game)) return;
+        crc.resize(std::min(crc.find(L'|'), crc.size()));
+        if (crc.size() == 8 && crc != L"00000000") game.appId = FoldAscii(crc); // RetroArch writes zeros until it has hashed the file
+        game.source = L"retroarch";
+        games.push_back(std::move(game));
+    });
+}
+// An ES-DE or EmulationStation gamelist.xml: each <game>'s path, name, image and lastplayed, gathered tag by tag and handed
+// on at </game>. Hidden games stay out, and <folder> entries, which only describe folders, are passed over.
+void ReadGamelist(const PlaylistSource& source, const std::atomic<bool>& cancelled, std::vector<Game>& games) {
+    MappedFile file;
+    if (!file.Open(source.list)) return;
+    bool inGame = false, hidden = false;
+    std::wstring path, name, image;
+    uint64_t lastPlayed = 0;
+    StreamXmlTags(std::string_view((const char*)file.data, file.size), [&](std::string_view tag, std::string_view, std::string_view text) {
+        if (cancelled) return;
+        if (tag == "game") { inGame = true; hidden = false; path.clear(); name.clear(); image.clear(); lastPlayed = 0; }
+        else if (!inGame) return;
+        else if (tag == "path") path = XmlText(text);
+        else if (tag == "name") name = XmlText(text);
+        else if (tag == "image") image = XmlText(text);
+        else if (tag == "lastplayed") lastPlayed = ParseGamelistTime(text);
+        else if (tag == "hidden") hidden = text == "true";
+        else if (tag == "/game") {
+            inGame = false;
+            Game game;
+            if (hidden || path.empty() || !MakePlaylistGame(source, name, ResolveListPath(source.romFolder, path), L"", game)) return;
+            if (!image.empty()) game.art = ResolveListPath(source.romFolder, image);
+            game.lastPlayed = lastPlayed;
+            game.source = L"es-de";
+            games.push_back(std::move(game));
+        }
+    });
+}
+// A playlist or gamelist entry, launched through the list's emulator with {rom} and {core} filled in. An entry with no name is
+// named after its file. False when the arguments want a core and the entry has none.
+bool MakePlaylistGame(const PlaylistSource& source, std::wstring_view name, const std::wstring& rom, const std::wstring& core, Game& game) {
+    if (core.empty() && source.arguments.find(L"{core}") != std::wstring::npos) return false;
+    size_t slash = rom.find_last_of(L"\\#"), start = slash == std::wstring::npos ? 0 : slash + 1, dot = rom.rfind(L'.'); // path.zip#member.sfc names the member
+    game.name = !name.empty() ? std::wstring(name) : rom.substr(start, (dot != std::wstring::npos && dot >= start ? dot : rom.size()) - start);
+    game.path = source.emulator;
+    game.startDir = source.emulator.substr(0, source.emulator.rfind(L'\\'));
+    game.launchOptions = source.arguments;
+    for (auto [token, value] : {std::make_pair(std::wstring_view(L"{rom}"), &rom), std::make_pair(std::wstring_view(L"{core}"), &core)})
+        for (size_t at = 0; (at = game.launchOptions.find(token, at)) != std::wstring::npos; at += value->size()) game.launchOptions.replace(at, token.size(), *value);
+    return true;
+}
+// A listed path with Windows separators, made absolute against base when it is relative ("./Game.sfc", "snes/Game.sfc").
+std::wstring ResolveListPath(std::wstring_view base, std::wstring_view path) {
+    std::wstring resolved(path);
+    std::replace(resolved.begin(), resolved.end(), L'/', L'\\');
+    if ((!resolved.empty() && resolved[0] == L'\\') || (resolved.size() > 1 && resolved[1] == L':')) return resolved;
+    std::wstring_view relative(resolved);
+    while (relative.rfind(L".\\", 0) == 0) relative.remove_prefix(2);
+    return std::wstring(base) + L"\\" + std::wstring(relative);
+}
+// ES-DE's "20240131T201500", in local time, as Unix time; 0 when absent or malformed.
+uint64_t ParseGamelistTime(std::string_view text) {
+    if (text.size() < 15 || text[8] != 'T') return 0;
+    auto digits = [text](size_t at, size_t count) { return (WORD)ParseUint(text.substr(at, count)); };
+    SYSTEMTIME local = {}, utc;
+    local.wYear = digits(0, 4); local.wMonth = digits(4, 2); local.wDay = digits(6, 2);
+    local.wHour = digits(9, 2); local.wMinute = digits(11, 2); local.wSecond = digits(13, 2);
+    FILETIME time;
+    if (!TzSpecificLocalTimeToSystemTime(nullptr, &local, &utc) || !SystemTimeToFileTime(&utc, &time)) return 0;
+    uint64_t ticks = (uint64_t)time.dwHighDateTime << 32 | time.dwLowDateTime; // 100 ns since 1601
+    return ticks > 116444736000000000ull ? (ticks - 116444736000000000ull) / 10000000 : 0;
+}
+// Streams the file through Crc32 in kRomReadBytes chunks; FILE_FLAG_SEQUENTIAL_SCAN lets the cache manager read ahead.
+bool HashFileCrc32(const std::wstring& path, uint32_t& crc, uint64_t& bytes) {
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    std::vector<uint8_t> buffer(kRomReadBytes);
+    DWORD read = 0;
+    bool ok;
+    crc = 0;
+    while ((ok = ReadFile(file, buffer.data(), (DWORD)buffer.size(), &read, nullptr) != 0) && read != 0) { crc = Crc32(crc, buffer.data(), read); bytes += read; }
+    CloseHandle(file);
+    return ok;
+}
+// The end-of-central-directory record (or its Zip64 form, for archives past 4 GB or 65535 members) locates the central
+// directory, whose entries carry each member's CRC32 and uncompressed size.
+bool ReadZipMembers(const uint8_t* data, size_t size, std::vector<ArchiveMember>& members) {
+    auto u16 = [data](uint64_t at) { uint16_t value; memcpy(&value, data + at, 2); return (uint64_t)value; };
+    auto u32 = [data](uint64_t at) { uint32_t value; memcpy(&value, data + at, 4); return (uint64_t)value; };
+    auto u64 = [data](uint64_t at) { uint64_t value; memcpy(&value, data + at, 8); return value; };
+    if (size < 22) return false;
+    size_t eocd = size - 22, stop = size - 22 > 65535 ? size - 22 - 65535 : 0; // The archive comment is at most 65535 bytes
+    while (u32(eocd) != 0x06054b50) if (eocd-- == stop) return false;
+    uint64_t count = u16(eocd + 10), at = u32(eocd + 16);
+    if (eocd >= 20 && u32(eocd - 20) == 0x07064b50) {
+        uint64_t zip64 = u64(eocd - 20 + 8);
+        if (size < 56 || zip64 > size - 56 || u32(zip64) != 0x06064b50) return false;
+        count = u64(zip64 + 32);
+        at = u64(zip64 + 48);
+    }
+    for (uint64_t i = 0; i < count; i++) {
+        if (at > size || size - at < 46 || u32(at) != 0x02014b50) return false;
+        uint64_t nameLength = u16(at + 28), extraLength = u16(at + 30), commentLength = u16(at + 32), length = u32(at + 24);
+        if (size - at - 46 < nameLength + extraLength) return false;
+        // Zip64 extra field: the 64-bit uncompressed size comes first when the 32-bit one is saturated.
+        for (uint64_t extra = at + 46 + nameLength, stopExtra = extra + extraLength; length == 0xFFFFFFFF && extra + 4 <= stopExtra; ) {
+            uint64_t id = u16(extra), fieldSize = u16(extra + 2);
+            if (id == 1 && fieldSize >= 8 && extra + 12 <= stopExtra) length = u64(extra + 4);
+            extra += 4 + fieldSize;
+        }
+        if (nameLength == 0 || data[at + 46 + nameLength - 1] != '/') members.push_back({(uint32_t)u32(at + 16), length});
+        at += 46 + nameLength + extraLength + commentLength;
+    }
+    return true;
+}
+// 7-Zip keeps its header at the end, located by the 32-byte signature header. A plain header (k7zHeader) lists every
+// stream's size and CRC32 in its streams info and which files have a stream in its files info. A compressed one
+// (kEncodedHeader, 7-Zip's default) would need LZMA to read, so those archives fall back to their file name.
+bool Read7zMembers(const uint8_t* data, size_t size, std::vector<ArchiveMember>& members) {
+    if (size < 32 || memcmp(data, "7z\xBC\xAF\x27\x1C", 6) != 0) return false;
+    uint64_t offset, length;
+    memcpy(&offset, data + 12, 8);
+    memcpy(&length, data + 20, 8);
+    if (offset > size - 32 || length > size - 32 - offset) return false;
+    SevenZipReader header{data + 32 + offset, data + 32 + offset + length};
+    if (header.Byte() != k7zHeader) return false;
+    uint64_t id = header.Number();
+    if (id == k7zArchiveProperties) {
+        for (uint64_t type; header.ok && (type = header.Number()) != k7zEnd; ) header.Skip(header.Number());
+        id = header.Number();
+    }
+    if (id == k7zAdditionalStreams) return false;
+    std::vector<uint64_t> folderSizes, sizes;
+    std::vector<uint32_t> folderCrcs, crcs;
+    std::vector<bool> folderCrcKnown, crcKnown;
+    std::vector<uint64_t> substreams;
+    if (id == k7zMainStreams) {
+        for (uint64_t section; header.ok && (section = header.Number()) != k7zEnd; ) {
+            if (section == k7zPackInfo) {
+                header.Number(); // Pack position
+                uint64_t packStreams = header.Number();
+                if (!header.Fits(packStreams)) return false;
+                for (uint64_t type; header.ok && (type = header.Number()) != k7zEnd; ) {
+                    if (type == k7zSize) for (uint64_t i = 0; i < packStreams; i++) header.Number();
+                    else if (type == k7zCrc) { std::vector<bool> defined = header.Defined((size_t)packStreams); for (bool known : defined) if (known) header.UInt32(); }
+                    else return false;
+                }
+            }
+            else if (section == k7zUnpackInfo) {
+                if (header.Number() != k7zFolder) return false;
+                uint64_t folders = header.Number();
+                if (!header.Fits(folders) || header.Byte() != 0) return false; // External folder data is never written
+                std::vector<uint64_t> outputs(folders), mainOutput(folders);
+                for (uint64_t f = 0; f < folders && header.ok; f++) {
+                    uint64_t coders = header.Number(), inputs = 0;
+                    if (!header.Fits(coders)) return false;
+                    for (uint64_t c = 0; c < coders; c++) {
+                        uint8_t flags = header.Byte();
+                        header.Skip(flags & 0x0F);
+                        if (flags & 0x10) { inputs += header.Number(); outputs[f] += header.Number(); } else { inputs++; outputs[f]++; }
+                        if (flags & 0x20) header.Skip(header.Number());
+                    }
+                    if (!header.Fits(outputs[f]) || outputs[f] == 0 || inputs < outputs[f] - 1) return false;
+                    // Every output but one feeds another coder; the one left over is the folder's unpacked data.
+                    std::vector<bool> bound((size_t)outputs[f]);
+                    for (uint64_t b = 0; b + 1 < outputs[f]; b++) { header.Number(); uint64_t output = header.Number(); if (output < outputs[f]) bound[(size_t)output] = true; }
+                    mainOutput[f] = std::find(bound.begin(), bound.end(), false) - bound.begin();
+                    uint64_t packed = inputs - (outputs[f] - 1);
+                    if (packed > 1) for (uint64_t i = 0; i < packed; i++) header.Number();
+                }
+                if (header.Number() != k7zCodersUnpackSize) return false;
+                for (uint64_t f = 0; f < folders; f++) for (uint64_t o = 0; o < outputs[f]; o++) { uint64_t unpacked = header.Number(); if (o == mainOutput[f]) folderSizes.push_back(unpacked); }
+                folderCrcs.assign((size_t)folders, 0);
+                folderCrcKnown.assign((size_t)folders, false);
+                for (uint64_t type; header.ok && (type = header.Number()) != k7zEnd; ) {
+                    if (type != k7zCrc) return false;
+                    folderCrcKnown = header.Defined((size_t)folders);
+                    for (size_t f = 0; f < folderCrcKnown.size(); f++) if (folderCrcKnown[f]) folderCrcs[f] = header.UInt32();
+                }
+            }
+            else if (section == k7zSubStreamsInfo) {
+                substreams.assign(folderSizes.size(), 1);
+                uint64_t type = header.Number();
+                if (type == k7zNumUnpackStream) {
+                    for (auto& count : substreams) if (!header.Fits(count = header.Number())) return false;
+                    type = header.Number();
+                }
+                for (size_t f = 0; f < substreams.size(); f++) {
+                    if (substreams[f] == 0) continue;
+                    uint64_t sum = 0;
+                    if (type == k7zSize) for (uint64_t k = 1; k < substreams[f]; k++) { sizes.push_back(header.Number()); sum += sizes.back(); }
+                    sizes.push_back(folderSizes[f] - sum);
+                }
+                if (type == k7zSize) type = header.Number();
+                // Digests follow for every stream whose CRC the folder does not already give: all but a folder's only stream.
+                for (size_t f = 0; f < substreams.size(); f++) for (uint64_t k = 0; k < substreams[f]; k++) {
+                    bool fromFolder = substreams[f] == 1 && folderCrcKnown[f];
+                    crcs.push_back(fromFolder ? folderCrcs[f] : 0);
+                    crcKnown.push_back(fromFolder);
+                }
+                for (; header.ok && type != k7zEnd; type = header.Number()) {
+                    if (type != k7zCrc) return false;
+                    size_t unknown = (size_t)std::count(crcKnown.begin(), crcKnown.end(), false);
+                    std::vector<bool> defined = header.Defined(unknown);
+                    for (size_t s = 0, u = 0; s < crcKnown.size() && u < defined.size(); s++) if (!crcKnown[s] && defined[u++]) { crcs[s] = header.UInt32(); crcKnown[s] = true; }
+                }
+            }
+            else return false;
+        }
+        if (substreams.empty()) { sizes = folderSizes; crcs = folderCrcs; crcKnown = folderCrcKnown; }
+        id = header.Number();
+    }
+    // Files without a stream (folders, empty files) are flagged in kEmptyStream; the rest take the streams in order.
+    std::vector<bool> empty;
+    if (id == k7zFilesInfo) {
+        uint64_t files = header.Number();
+        if (!header.Fits(files)) return false;
+        empty.assign((size_t)files, false);
+        for (uint64_t type; header.ok && (type = header.Number()) != k7zEnd; ) {
+            uint64_t propertySize = header.Number();
+            if (propertySize > (uint64_t)(header.end - header.p)) return false;
+            SevenZipReader property{header.p, header.p + propertySize};
+            if (type == k7zEmptyStream) empty = property.Bits((size_t)files);
+            header.Skip(propertySize);
+        }
+    }
+    if (!header.ok) return false;
+    size_t stream = 0;
+    for (size_t f = 0; f < (empty.empty() ? sizes.size() : empty.size()) && stream < sizes.size(); f++) {
+        if (!empty.empty() && empty[f]) continue;
+        if (stream < crcKnown.size() && crcKnown[stream]) members.push_back({crcs[stream], sizes[stream]});
+        stream++;
+    }
+    return true;
+}
+uint8_t SevenZipReader::Byte() {
+    if (p >= end) { ok = false; return 0; }
+    return *p++;
+}
+// The first byte's leading one bits count the extra bytes that follow; its remaining bits are the value's top bits.
+uint64_t SevenZipReader::Number() {
+    uint8_t first = Byte();
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        uint8_t mask = (uint8_t)(0x80 >> i);
+        if (!(first & mask)) return value | (uint64_t)(first & (mask - 1)) << (8 * i);
+        value |= (uint64_t)Byte() << (8 * i);
+    }
+    return value;
+}
+uint32_t SevenZipReader::UInt32() {
+    if (end - p < 4) { ok = false; p = end; return 0; }
+    uint32_t value;
+    memcpy(&value, p, 4);
+    p += 4;
+    return value;
+}
+void SevenZipReader::Skip(uint64_t size) {
+    if (size > (uint64_t)(end - p)) { ok = false; p = end; }
+    else p += size;
+}
+std::vector<bool> SevenZipReader::Bits(size_t count) {
+    std::vector<bool> bits(Fits(count) ? count : 0);
+    uint8_t byte = 0;
+    for (size_t i = 0; i < bits.size(); i++) {
+        if (i % 8 == 0) byte = Byte();
+        bits[i] = (byte & (0x80 >> (i % 8))) != 0;
+    }
+    return bits;
+}
+// A byte saying whether all items are defined, followed by the bit vector when they are not.
+std::vector<bool> SevenZipReader::Defined(size_t count) {
+    if (Byte() == 0) return Bits(count);
+    return std::vector<bool>(Fits(count) ? count : 0, true);
+}
+// Only game, machine, rom and serial tags are looked at; everything else, the header included, is passed over.
+bool RomDat::Load(const std::wstring& path) {
+    MappedFile file;
+    if (!GetFileStamp(path, stamp) || !file.Open(path)) return false;
+    StreamXmlTags(std::string_view((const char*)file.data, file.size), [&](std::string_view tag, std::string_view attributes, std::string_view text) {
+        if (tag == "game" || tag == "machine") names.push_back(XmlText(XmlAttribute(attributes, "name")));
+        else if (tag == "rom" && !names.empty()) {
+            std::string_view crc = XmlAttribute(attributes, "crc");
+            uint32_t value = 0;
+            if (crc.size() == 8 && std::from_chars(crc.data(), crc.data() + 8, value, 16).ptr == crc.data() + 8)
+                roms.emplace((uint64_t)value << 32 | (uint32_t)ParseUint(XmlAttribute(attributes, "size")), (uint32_t)(names.size() - 1));
+        }
+        std::string_view serial = tag == "serial" ? text : tag == "game" ? XmlAttribute(attributes, "serial") : std::string_view();
+        // Redump lists every release of a disc, comma-separated: "SLUS-00594, SLUS-00595".
+        for (size_t from = 0, comma; !names.empty() && from < serial.size(); from = comma + 1) {
+            comma = std::min(serial.find(',', from), serial.size());
+            std::string key = NormalizeSerial(serial.substr(from, comma - from));
+            if (!key.empty()) serials.emplace(std::move(key), (uint32_t)(names.size() - 1));
+        }
+    });
+    return !roms.empty() || !serials.empty();
+}
+const std::wstring* RomDat::FindSerial(std::string_view serial) const {
+    auto found = serials.find(NormalizeSerial(serial));
+    return found != serials.end() ? &names[found->second] : nullptr;
+}
+// Upper case, spaces dropped and the PlayStation boot file spelling folded into the catalogue one: SLUS_005.94 -> SLUS-00594.
+std::string NormalizeSerial(std::string_view serial) {
+    std::string key;
+    for (char c : serial) {
+        if (c == '_') key += '-';
+        else if (c != '.' && c != ' ' && c != '\t' && c != '\r' && c != '\n') key += (char)toupper((unsigned char)c);
+    }
+    return key;
+}
+// GameCube and Wii discs start with their boot header; Dolphin's WIA and RVZ keep its first 0x80 bytes uncompressed in the
+// disc struct after the file header. A PlayStation disc names its boot executable, which is the serial, in SYSTEM.CNF.
+bool ReadDiscInfo(const std::wstring& path, std::wstring_view extension, DiscInfo& info, uint64_t& bytesRead) {
+    DiscImage image;
+    if (!image.Open(path)) return false;
+    uint8_t header[kGameCubeHeaderBytes];
+    bool found = false;
+    if (extension == L"rvz" || extension == L"wia") {
+        found = image.ReadAt(0, header, 4) && (memcmp(header, "WIA\x01", 4) == 0 || memcmp(header, "RVZ\x01", 4) == 0)
+            && image.ReadAt(kWiaDiscHeaderOffset, header, kWiaDiscHeaderBytes) && ReadGameCubeHeader(header, kWiaDiscHeaderBytes, info);
+    }
+    else {
+        found = !image.chdHunkBytes && image.unitBytes == kIsoSectorBytes && image.ReadAt(0, header, sizeof(header)) && ReadGameCubeHeader(header, sizeof(header), info);
+        if (!found) found = ReadPlayStationSerial(image, info);
+    }
+    bytesRead = image.bytesRead;
+    return found;
+}
+// ID6 (game code, region, maker) at 0, the magic word at 0x18 (Wii) or 0x1C (GameCube), the title from 0x20. Japanese discs
+// write the title in Shift-JIS.
+bool ReadGameCubeHeader(const uint8_t* header, size_t size, DiscInfo& info) {
+    auto bigEndian = [header](size_t at) { return (uint32_t)header[at] << 24 | (uint32_t)header[at + 1] << 16 | (uint32_t)header[at + 2] << 8 | header[at + 3]; };
+    if (size < 0x20 || (bigEndian(0x1C) != kGameCubeMagic && bigEndian(0x18) != kWiiMagic)) return false;
+    for (size_t i = 0; i < 6; i++) if (!isalnum(header[i])) return false;
+    info.serial.assign((const char*)header, 6);
+    size_t length = 0;
+    while (0x20 + length < size && header[0x20 + length]) length++;
+    UINT codePage = header[3] == 'J' ? 932 : 1252;
+    int wide = MultiByteToWideChar(codePage, 0, (const char*)header + 0x20, (int)length, nullptr, 0);
+    info.title.assign(wide, L'\0');
+    if (wide) MultiByteToWideChar(codePage, 0, (const char*)header + 0x20, (int)length, &info.title[0], wide);
+    while (!info.title.empty() && iswspace(info.title.back())) info.title.pop_back();
+    return true;
+}
+// ISO 9660: the primary volume descriptor (sector 16) points at the root directory, whose SYSTEM.CNF;1 record points at the
+// file. Its BOOT (PS1) or BOOT2 (PS2) line names the executable, e.g. cdrom0:\SLUS_212.34;1. Four sectors in all.
+bool ReadPlayStationSerial(DiscImage& image, DiscInfo& info) {
+    uint8_t sector[kIsoSectorBytes];
+    if (!image.ReadSector(kIsoDescriptorSector, sector) || sector[0] != 1 || memcmp(sector + 1, "CD001", 5) != 0) return false;
+    auto littleEndian = [](const uint8_t* at) { uint32_t value; memcpy(&value, at, 4); return value; };
+    uint32_t rootSector = littleEndian(sector + 156 + 2), rootBytes = std::min<uint32_t>(littleEndian(sector + 156 + 10), 4 * kIsoSectorBytes);
+    uint32_t fileSector = 0, fileBytes = 0;
+    for (uint32_t at = 0; at < rootBytes && !fileSector; at += kIsoSectorBytes) {
+        if (!image.ReadSector(rootSector + at / kIsoSectorBytes, sector)) return false;
+        // Records never straddle a sector; a zero length byte pads the rest of one.
+        for (uint32_t record = 0; record + 33 < kIsoSectorBytes && sector[record] != 0; record += sector[record]) {
+            uint8_t nameLength = sector[record + 32];
+            if (record + 33 + nameLength > kIsoSectorBytes || sector[record] < 34) break;
+            std::string_view name((const char*)sector + record + 33, nameLength);
+            name = name.substr(0, name.find(';'));
+            if (name.size() == 10 && _strnicmp(name.data(), "SYSTEM.CNF", 10) == 0) { fileSector = littleEndian(sector + record + 2); fileBytes = littleEndian(sector + record + 10); break; }
+        }
+    }
+    if (!fileSector || !image.ReadSector(fileSector, sector)) return false;
+    std::string_view text((const char*)sector, std::min<uint32_t>(fileBytes, kIsoSectorBytes));
+    for (size_t start = 0, end; start < text.size(); start = end + 1) {
+        end = std::min(text.find('\n', start), text.size());
+        std::string_view line = text.substr(start, end - start);
+        if (line.rfind("BOOT", 0) != 0) continue;
+        size_t begin = line.find_last_of("\\:/");
+        if (begin == std::string_view::npos) continue;
+        std::string_view executable = line.substr(begin + 1);
+        executable = executable.substr(0, executable.find_first_of(";\r \t"));
+        if (executable.size() < 8) continue;
+        info.serial = NormalizeSerial(executable);
+        return true;
+    }
+    return false;
+}
+bool DiscImage::Open(const std::wstring& path) {
+    std::wstring imagePath = path;
+    size_t dot = path.rfind(L'.');
+    if (dot != std::wstring::npos && FoldAscii(std::wstring_view(path).substr(dot)) == L".cue") {
+        // The first FILE line names the data track; the sync-pattern check below tells its sector layout.
+        std::string cue;
+        if (!ReadFileBytes(path, cue)) return false;
+        size_t line = cue.find("FILE ");
+        if (line == std::string::npos) return false;
+        size_t open = cue.find('"', line), close = open == std::string::npos ? open : cue.find('"', open + 1);
+        if (close == std::string::npos) return false;
+        std::wstring name = Utf8ToWide(std::string_view(cue).substr(open + 1, close - open - 1));
+        imagePath = name.find(L':') != std::wstring::npos ? name : path.substr(0, path.rfind(L'\\') + 1) + name;
+    }
+    file = CreateFileW(imagePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    uint8_t header[kChdV5HeaderBytes];
+    if (ReadAt(0, header, sizeof(header)) && memcmp(header, "MComprHD", 8) == 0) {
+        auto bigEndian = [&header](size_t at) { return (uint32_t)header[at] << 24 | (uint32_t)header[at + 1] << 16 | (uint32_t)header[at + 2] << 8 | header[at + 3]; };
+        // Version 5 (chdman since 0.146): four compressor tags, all zero when hunks are stored as they are.
+        if (bigEndian(12) != 5 || bigEndian(16) || bigEndian(20) || bigEndian(24) || bigEndian(28)) return false;
+        chdMapOffset = (uint64_t)bigEndian(40) << 32 | bigEndian(44);
+        chdHunkBytes = bigEndian(56);
+        unitBytes = bigEndian(60);
+        if (!chdHunkBytes || !unitBytes || unitBytes > chdHunkBytes) return false;
+    }
+    // A raw CD sector opens with the 12-byte sync pattern, then the address and mode bytes.
+    static const uint8_t sync[12] = { 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00 };
+    uint8_t raw[16];
+    if (!chdHunkBytes) unitBytes = kCdRawSectorBytes;
+    if (unitBytes >= kCdRawSectorBytes && ReadUnit(kIsoDescriptorSector, 0, raw, sizeof(raw)) && memcmp(raw, sync, sizeof(sync)) == 0) dataOffset = raw[15] == 2 ? 24 : 16;
+    else if (!chdHunkBytes) unitBytes = kIsoSectorBytes;
+    return true;
+}
+bool DiscImage::ReadAt(uint64_t offset, void* out, size_t size) {
+    LARGE_INTEGER position; position.QuadPart = (LONGLONG)offset;
+    DWORD read = 0;
+    bool ok = SetFilePointerEx(file, position, nullptr, FILE_BEGIN) && ReadFile(file, out, (DWORD)size, &read, nullptr) && read == size;
+    bytesRead += read;
+    return ok;
+}
+// A CHD map entry is the hunk's offset in the file divided by the hunk size; 0 means the hunk was never written (all zero).
+bool DiscImage::ReadUnit(uint32_t lba, uint32_t offset, void* out, size_t size) {
+    uint64_t at = (uint64_t)lba * unitBytes + offset;
+    if (!chdHunkBytes) return ReadAt(at, out, size);
+    uint8_t entry[4];
+    if (!ReadAt(chdMapOffset + at / chdHunkBytes * 4, entry, sizeof(entry))) return false;
+    uint64_t hunk = (uint64_t)entry[0] << 24 | (uint32_t)entry[1] << 16 | (uint32_t)entry[2] << 8 | entry[3];
+    if (hunk == 0) { memset(out, 0, size); return true; }
+    return ReadAt(hunk * chdHunkBytes + at % chdHunkBytes, out, size);
+}
+bool DiscImage::ReadSector(uint32_t lba, uint8_t* out) { return ReadUnit(lba, dataOffset, out, kIsoSectorBytes); }
+const std::wstring* RomDat::Find(uint32_t crc, uint64_t size) const {
+    auto found = roms.find((uint64_t)crc << 32 | (uint32_t)size);
+    return found != roms.end() ? &names[found->second] : nullptr;
+}
+// Walks an XML document's tags in order without building anything, SAX style: each tag's name ("/game" for a closing tag), its
+// attribute text (see XmlAttribute) and the character data up to the next tag, undecoded (see XmlText), go to onTag.
+// Comments are skipped; CDATA sections and quoted '>' inside attributes are not understood.
+void StreamXmlTags(std::string_view xml, const std::function<void(std::string_view, std::string_view, std::string_view)>& onTag) {
+    for (size_t at = xml.find('<'); at != std::string_view::npos; ) {
+        if (xml.compare(at, 4, "<!--") == 0) {
+            size_t end = xml.find("-->", at + 4);
+            at = end == std::string_view::npos ? end : xml.find('<', end + 3);
+            continue;
+        }
+        size_t close = xml.find('>', at), nameEnd = std::min(xml.find_first_of(" \t\r\n/>", at + 2), close);
+        if (close == std::string_view::npos) return;
+        size_t next = xml.find('<', close + 1);
+        std::string_view tag = xml.substr(at + 1, nameEnd - at - 1), attributes = xml.substr(nameEnd, close - nameEnd);
+        onTag(tag, attributes, xml.substr(close + 1, (next == std::string_view::npos ? xml.size() : next) - close - 1));
+        at = next;
+    }
+}
+// The value of attribute `name` within a tag's attribute text, quotes removed; empty when the tag has no such attribute.
+std::string_view XmlAttribute(std::string_view attributes, std::string_view name) {
+    for (size_t at = attributes.find(name); at != std::string_view::npos; at = attributes.find(name, at + 1)) {
+        if (at == 0 || !isspace((unsigned char)attributes[at - 1])) continue;
+        size_t value = attributes.find_first_not_of(" \t\r\n", at + name.size());
+        if (value == std::string_view::npos || attributes[value] != '=') continue;
+        value = attributes.find_first_not_of(" \t\r\n", value + 1);
+        if (value == std::string_view::npos || (attributes[value] != '"' && attributes[value] != '\'')) continue;
+        size_t end = attributes.find(attributes[value], value + 1);
+        return end == std::string_view::npos ? std::string_view() : attributes.substr(value + 1, end - value - 1);
+    }
+    return {};
+}
+// UTF-8 attribute text with the five named entities and numeric character references decoded.
+std::wstring XmlText(std::string_view text) {
+    std::wstring wide = Utf8ToWide(text), out;
+    out.reserve(wide.size());
+    for (size_t i = 0; i < wide.size(); i++) {
+        size_t semicolon = wide[i] == L'&' ? wide.find(L';', i) : std::wstring::npos;
+        if (semicolon == std::wstring::npos || semicolon - i > 10) { out += wide[i]; continue; }
+        std::wstring_view entity = std::wstring_view(wide).substr(i + 1, semicolon - i - 1);
+        if (entity == L"amp") out += L'&';
+        else if (entity == L"lt") out += L'<';
+        else if (entity == L"gt") out += L'>';
+        else if (entity == L"quot") out += L'"';
+        else if (entity == L"apos") out += L'\'';
+        else if (entity.size() > 1 && entity[0] == L'#') {
+            uint32_t code = entity[1] == L'x' ? wcstoul(std::wstring(entity.substr(2)).c_str(), nullptr, 16) : wcstoul(std::wstring(entity.substr(1)).c_str(), nullptr, 10);
+            if (code >= 0x10000 && code <= 0x10FFFF) { out += (wchar_t)(0xD800 + ((code - 0x10000) >> 10)); out += (wchar_t)(0xDC00 + ((code - 0x10000) & 0x3FF)); }
+            else if (code != 0 && code < 0x10000) out += (wchar_t)code;
+        }
+        else { out += wide[i]; continue; }
+        i = semicolon;
+    }
+    return out;
+}
+// True when path is a claimed folder or lies inside one. Walking up the parents keeps this a few hash lookups.
+bool IsClaimedInstall(std::wstring_view path) {
+    if (g_claimedInstalls.empty()) return false;
+    std::wstring key = NormalizePathKey(path);
+    for (;;) {
+        if (g_claimedInstalls.count(key)) return true;
+        size_t slash = key.rfind(L'\\');
+        if (slash == std::wstring::npos || slash < 3) return false;
+        key.resize(slash);
+    }
+}
+std::wstring CanonicalPaths::Key(std::wstring_view path) {
+    std::wstring key = NormalizePathKey(path);
+    size_t slash = key.rfind(L'\\');
+    if (slash == std::wstring::npos || slash < 3) return key;
+    std::wstring folder = key.substr(0, slash);
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto known = folders.find(folder);
+        if (known != folders.end()) return key.replace(0, slash, known->second);
+    }
+    // Opened with no access at all, which is enough to ask for its name and never conflicts with another process's sharing.
+    std::wstring resolved = folder;
+    HANDLE handle = CreateFileW(folder.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+    if (handle != INVALID_HANDLE_VALUE) {
+        std::wstring final(MAX_PATH, L'\0');
+        DWORD length = GetFinalPathNameByHandleW(handle, &final[0], (DWORD)final.size(), FILE_NAME_NORMALIZED | VOLUME_NAME_DOS);
+        if (length >= final.size()) { final.resize(length); length = GetFinalPathNameByHandleW(handle, &final[0], (DWORD)final.size(), FILE_NAME_NORMALIZED | VOLUME_NAME_DOS); }
+        CloseHandle(handle);
+        if (length != 0 && length < final.size()) {
+            std::wstring_view name(final.data(), length);
+            if (name.rfind(L"\\\\?\\UNC\\", 0) == 0) resolved = NormalizePathKey(L"\\" + std::wstring(name.substr(7)));
+            else if (name.rfind(L"\\\\?\\", 0) == 0) resolved = NormalizePathKey(name.substr(4));
+            else resolved = NormalizePathKey(name);
+        }
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    folders.emplace(std::move(folder), resolved);
+    return key.replace(0, slash, resolved);
+}
+// Two records launch the same thing when their arguments match, or when one has none and the other's only say how to run the
+// install (a Steam launch option). ROM, playlist and shortcut records say what to run: they start one emulator with many
+// games, so each stays a game of its own and the emulator's own argument-less entry stays apart from them.
+bool SharesLaunch(const Game& a, const Game& b) {
+    if (a.launchOptions == b.launchOptions) return true;
+    if (!a.launchOptions.empty() && !b.launchOptions.empty()) return false;
+    const std::wstring& source = (a.launchOptions.empty() ? b : a).source;
+    return source != L"rom" && source != L"retroarch" && source != L"es-de" && source != L"steam-shortcut";
+}
+// Names one record of the library for the frontend and ApplyLibraryChanges. The path alone does not: every ROM and playlist
+// game shares its emulator's. MergeDuplicateGames leaves one record per path and arguments.
+std::wstring GameKey(const Game& game) { return game.path + L'\n' + game.launchOptions; }
+// How much a record lets the library show and launch: a store id and play history count most. An Uninstall guess scores 0.
+int RecordRichness(const Game& game) {
+    return (game.appId.empty() ? 0 : 4) + (game.lastPlayed || game.playtimeMinutes ? 2 : 0) + !game.launchOptions.empty() + !game.startDir.empty()
+        + !game.art.empty() + (game.sizeOnDisk != 0) + (game.buildId != 0);
+}
+// Folds other into kept: the richer record stays (kept on a tie) and foundBy gains other's scanners, the winner's first.
+void MergeGameRecord(Game& kept, Game&& other) {
+    std::vector<std::wstring> foundBy = std::move(kept.foundBy);
+    if (foundBy.empty()) foundBy.push_back(kept.source);
+    if (other.foundBy.empty()) other.foundBy.push_back(other.source);
+    for (auto& source : other.foundBy) if (std::find(foundBy.begin(), foundBy.end(), source) == foundBy.end()) foundBy.push_back(std::move(source));
+    if (RecordRichness(other) > RecordRichness(kept)) kept = std::move(other);
+    auto winner = std::find(foundBy.begin(), foundBy.end(), kept.source);
+    if (winner != foundBy.end()) std::rotate(foundBy.begin(), winner, winner + 1);
+    kept.foundBy = std::move(foundBy);
+}
+// One record per install across providers, in one pass over the library. Records are keyed by canonical exe path plus
+// arguments; one without arguments also joins the first record for its exe, and a record joins an argument-less first one,
+// unless the arguments pick content to run (see SharesLaunch).
+// Earlier records win ties, so provider order decides between equally rich ones.
+void MergeDuplicateGames(std::vector<Game>& games) {
+    std::vector<std::wstring> paths(games.size());
+    g_workerPool.ParallelFor(games.size(), [&](size_t i) { paths[i] = g_canonicalPaths.Key(games[i].path); });
+    std::unordered_map<std::wstring, size_t> byLaunch, byPath;
+    byLaunch.reserve(games.size());
+    byPath.reserve(games.size());
+    size_t kept = 0;
+    for (size_t i = 0; i < games.size(); i++) {
+        std::wstring launchKey = paths[i] + L'\n' + games[i].launchOptions;
+        auto match = byLaunch.find(launchKey);
+        size_t into = match != byLaunch.end() ? match->second : SIZE_MAX;
+        if (into == SIZE_MAX) {
+            auto first = byPath.find(paths[i]);
+            if (first != byPath.end() && SharesLaunch(games[first->second], games[i])) into = first->second;
+        }
+        if (into == SIZE_MAX) {
+            if (kept != i) games[kept] = std::move(games[i]);
+            if (games[kept].foundBy.empty()) games[kept].foundBy.push_back(games[kept].source);
+            byPath.emplace(std::move(paths[i]), kept);
+            byLaunch.emplace(std::move(launchKey), kept++);
+            continue;
+        }
+        MergeGameRecord(games[into], std::move(games[i]));
+        byLaunch.emplace(std::move(launchKey), into);
+        byLaunch.emplace(paths[i] + L'\n' + games[into].launchOptions, into);
+    }
+    games.erase(games.begin() + kept, games.end());
+}
+// Walks the members of a JSON document's top-level object without building anything: each member's key (as written, without
+// its quotes) and raw value text go to onMember. A string value keeps its quotes and escapes for JsonToWide; an array or object
+// comes back as one span, found by bracket matching and never looked into. Returns false on malformed input.
+bool StreamJsonObject(std::string_view data, const std::function<void(std::string_view, std::string_view)>& onMember) {
+    auto skipSpace = [&data](size_t i) { while (i < data.size() && (data[i] == ' ' || data[i] == '\t' || data[i] == '\r' || data[i] == '\n')) i++; return i; };
+    size_t i = data.find('{');
+    if (i == std::string_view::npos) return false;
+    for (i++;;) {
+        i = skipSpace(i);
+        if (i < data.size() && data[i] == '}') return true;
+        if (i >= data.size() || data[i] != '"') return false;
+        size_t keyEnd = SkipJsonValue(data, i);
+        if (keyEnd == std::string_view::npos) return false;
+        std::string_view key = data.substr(i + 1, keyEnd - i - 2);
+        i = skipSpace(keyEnd);
+        if (i >= data.size() || data[i] != ':') return false;
+        i = skipSpace(i + 1);
+        size_t valueEnd = SkipJsonValue(data, i);
+        if (valueEnd == std::string_view::npos) return false;
+        onMember(key, data.substr(i, valueEnd - i));
+        i = skipSpace(valueEnd);
+        if (i < data.size() && data[i] == ',') { i++; continue; }
+        return i < data.size() && data[i] == '}';
+    }
+}
+// Hands each element of a JSON array, as raw text, to onElement. Returns false on malformed input.
+bool StreamJsonArray(std::string_view data, const std::function<void(std::string_view)>& onElement) {
+    auto skipSpace = [&data](size_t i) { while (i < data.size() && (data[i] == ' ' || data[i] == '\t' || data[i] == '\r' || data[i] == '\n')) i++; return i; };
+    size_t i = skipSpace(0);
+    if (i >= data.size() || data[i] != '[') return false;
+    i = skipSpace(i + 1);
+    if (i < data.size() && data[i] == ']') return true;
+    for (;;) {
+        size_t end = SkipJsonValue(data, i);
+        if (end == std::string_view::npos) return false;
+        onElement(data.substr(i, end - i));
+        i = skipSpace(end);
+        if (i < data.size() && data[i] == ',') { i = skipSpace(i + 1); continue; }
+        return i < data.size() && data[i] == ']';
+    }
+}
+// Index just past the JSON value that starts at i, or npos if there is none.
+size_t SkipJsonValue(std::string_view data, size_t i) {
+    size_t start = i;
+    int depth = 0;
+    for (; i < data.size(); i++) {
+        char c = data[i];
+        if (c == '"') {
+            for (i++; i < data.size() && data[i] != '"'; i++) if (data[i] == '\\') i++;
+            if (i >= data.size()) return std::string_view::npos;
+            if (depth == 0) return i + 1;
+        }
+        else if (c == '{' || c == '[') depth++;
+        else if (c == '}' || c == ']') {
+            if (depth == 0) return i == start ? std::string_view::npos : i;
+            if (--depth == 0) return i + 1;
+        }
+        else if (depth == 0 && (c == ',' || c == ' ' || c == '\t' || c == '\r' || c == '\n')) return i == start ? std::string_view::npos : i;
+    }
+    return depth != 0 || i == start ? std::string_view::npos : i;
+}
+// Decodes a quoted JSON string value; anything else comes back empty. Runs without escapes convert from UTF-8 in one go.
+std::wstring JsonToWide(std::string_view value) {
+    if (value.size() < 2 || value.front() != '"' || value.back() != '"') return L"";
+    value = value.substr(1, value.size() - 2);
+    std::wstring out;
+    for (size_t i = 0; i < value.size();) {
+        size_t escape = std::min(value.find('\\', i), value.size());
+        out += Utf8ToWide(value.substr(i, escape - i));
+        if (escape + 1 >= value.size()) break;
+        char c = value[escape + 1];
+        i = escape + 2;
+        switch (c) {
+        case 'b': out += L'\b'; break;
+        case 'f': out += L'\f'; break;
+        case 'n': out += L'\n'; break;
+        case 'r': out += L'\r'; break;
+        case 't': out += L'\t'; break;
+        case 'u': {
+            // UTF-16 code units, surrogate halves included, map straight onto wchar_t.
+            unsigned unit = 0;
+            if (i + 4 <= value.size() && std::from_chars(value.data() + i, value.data() + i + 4, unit, 16).ptr == value.data() + i + 4) { out += (wchar_t)unit; i += 4; }
+            break;
+        }
+        default: out += (wchar_t)c; break; // \" \\ \/
+        }
+    }
+    return out;
+}
+bool ReadKeyValuesFile(const std::wstring& path, std::string& buffer, KvTree& tree) { return ReadFileBytes(path, buffer) && ParseKeyValues(&buffer[0], buffer.size(), tree); }
+bool ScanCache::Load(const std::wstring& path) {
+    Close();
+    if (!mapped.Open(path) || mapped.size < sizeof(ScanCacheHeader)) { Close(); return false; }
+    const ScanCacheHeader* header = (const ScanCacheHeader*)mapped.data;
+    uint64_t expected = sizeof(ScanCacheHeader) + (uint64_t)header->recordCount * sizeof(ScanCacheRecord) + (uint64_t)header->exeCount * sizeof(ScanCacheExeRecord)
+        + (uint64_t)header->stringCount * sizeof(wchar_t);
+    if (header->magic != kScanCacheMagic || header->version != kScanCacheVersion || expected != (uint64_t)mapped.size) { Close(); return false; }
+    records = (const ScanCacheRecord*)(mapped.data + sizeof(ScanCacheHeader));
+    exeRecords = (const ScanCacheExeRecord*)(records + header->recordCount);
+    strings = (const wchar_t*)(exeRecords + header->exeCount);
+    stringCount = header->stringCount;
+    bool picksCurrent = header->pickSignature == pickSignature;
+    index.reserve(header->recordCount);
+    for (uint32_t i = 0; i < header->recordCount; i++) {
+        const ScanCacheRecord& r = records[i];
+        const ScanCacheString* fields[] = { &r.key, &r.name, &r.path, &r.appId, &r.source, &r.launchOptions, &r.startDir, &r.art };
+        bool valid = true;
+        for (const auto* field : fields) if ((uint64_t)field->offset + field->length > stringCount) valid = false;
+        if (valid && (picksCurrent || std::wstring_view(strings + r.source.offset, r.source.length) == L"rom"))
+            index.emplace(std::wstring_view(strings + records[i].key.offset, records[i].key.length), i);
+    }
+    exeIndex.reserve(picksCurrent ? header->exeCount : 0);
+    for (uint32_t i = 0; picksCurrent && i < header->exeCount; i++) {
+        const ScanCacheExeRecord& r = exeRecords[i];
+        if ((uint64_t)r.dir.offset + r.dir.length <= stringCount && (uint64_t)r.exe.offset + r.exe.length <= stringCount) exeIndex.emplace(std::wstring_view(strings + r.dir.offset, r.dir.length), i);
+    }
+    return true;
+}
+bool ScanCache::LookupExe(const std::wstring& dir, ScanCacheExeEntry& entry) const {
+    auto it = exeIndex.find(dir);
+    if (it == exeIndex.end()) return false;
+    const ScanCacheExeRecord& record = exeRecords[it->second];
+    entry = {dir, std::wstring(strings + record.exe.offset, record.exe.length), record.dirMtime, {record.exeMtime, record.exeSize}};
+    return true;
+}
+void ScanCache::StoreExe(const ScanCacheExeEntry& entry) { std::lock_guard<std::mutex> guard(freshExesLock); freshExes.push_back(entry); }
+bool ScanCache::Lookup(const std::wstring& key, const FileStamp& stamp, Game& game) const {
+    auto it = index.find(key);
+    if (it == index.end()) return false;
+    const ScanCacheRecord& record = records[it->second];
+    if (record.stamp != stamp.mtime || record.size != stamp.size) return false;
+    auto text = [this](const ScanCacheString& ref) { return std::wstring(strings + ref.offset, ref.length); };
+    game = {text(record.name), text(record.path), text(record.appId), record.sizeOnDisk, record.lastUpdated, record.bytesToDownload, record.buildId, record.stateFlags};
+    game.source = text(record.source); game.launchOptions = text(record.launchOptions); game.startDir = text(record.startDir); game.art = text(record.art);
+    return true;
+}
+void ScanCache::Store(const std::wstring& key, const FileStamp& stamp, const Game& game) { std::lock_guard<std::mutex> guard(freshLock); fresh[key] = {key, stamp, game}; }
+void ScanCache::Forget(const std::wstring& key) { std::lock_guard<std::mutex> guard(freshLock); fresh.erase(key); }
+bool ScanCache::Save(const std::wstring& path) {
+    // Install folders this scan never asked about (their manifest or registry key hit the cache) keep their entry while they exist.
+    std::unordered_set<std::wstring> stored;
+    for (const auto& entry : freshExes) stored.insert(entry.dir);
+    for (const auto& [dir, i] : exeIndex) {
+        ScanCacheExeEntry entry;
+        if (!stored.count(std::wstring(dir)) && GetFileAttributesW(std::wstring(dir).c_str()) != INVALID_FILE_ATTRIBUTES && LookupExe(std::wstring(dir), entry)) freshExes.push_back(entry);
+    }
+    Close();
+    std::vector<ScanCacheRecord> out;
+    std::vector<ScanCacheExeRecord> exeOut;
+    std::wstring pool;
+    auto add = [&pool](const std::wstring& text) { ScanCacheString ref = { (uint32_t)pool.size(), (uint32_t)text.size() }; pool += text; return ref; };
+    for (const auto& [key, entry] : fresh) {
+        const Game& game = entry.game;
+        out.push_back({ entry.stamp.mtime, entry.stamp.size, game.sizeOnDisk, game.lastUpdated, game.bytesToDownload, game.buildId, game.stateFlags,
+            add(entry.key), add(game.name), add(game.path), add(game.appId), add(game.source), add(game.launchOptions), add(game.startDir), add(game.art) });
+    }
+    stored.clear();
+    std::vector<ScanCacheExeEntry> latest;
+    for (auto entry = freshExes.rbegin(); entry != freshExes.rend(); ++entry) {
+        if (!stored.insert(entry->dir).second) continue;
+        exeOut.push_back({ entry->dirMtime, entry->exeStamp.mtime, entry->exeStamp.size, add(entry->dir), add(entry->exe) });
+        latest.push_back(std::move(*entry));
+    }
+    freshExes = std::move(latest);
+    ScanCacheHeader header = { kScanCacheMagic, kScanCacheVersion, (uint32_t)out.size(), (uint32_t)exeOut.size(), (uint32_t)pool.size(), pickSignature };
+    // Written beside the old cache and swapped in, so a crash mid-write never leaves a torn file behind.
+    std::wstring tempPath = path + L".tmp";
+    HANDLE temp = CreateFileW(tempPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (temp == INVALID_HANDLE_VALUE) { Load(path); return false; }
+    DWORD written = 0;
+    bool ok = WriteFile(temp, &header, sizeof(header), &written, nullptr)
+        && (out.empty() || WriteFile(temp, out.data(), (DWORD)(out.size() * sizeof(ScanCacheRecord)), &written, nullptr))
+        && (exeOut.empty() || WriteFile(temp, exeOut.data(), (DWORD)(exeOut.size() * sizeof(ScanCacheExeRecord)), &written, nullptr))
+        && (pool.empty() || WriteFile(temp, pool.data(), (DWORD)(pool.size() * sizeof(wchar_t)), &written, nullptr));
+    CloseHandle(temp);
+    // The old file had to be unmapped to be replaced; whichever file is now in place is mapped again, so lookups from the
+    // watcher and late providers keep hitting for the rest of the session.
+    bool saved = ok && MoveFileExW(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING);
+    if (!saved) DeleteFileW(tempPath.c_str());
+    Load(path);
+    return saved;
+}
+void WorkerPool::ParallelFor(size_t count, const std::function<void(size_t)>& body) {
+    if (count == 0) return;
+    struct Batch { std::atomic<size_t> next{0}, done{0}; size_t count = 0; const std::function<void(size_t)>* body = nullptr; std::mutex lock; std::condition_variable finished; };
+    auto batch = std::make_shared<Batch>();
+    batch->count = count; batch->body = &body;
+    // Helpers that only get scheduled after the batch drained find no index left and never touch `body`.
+    auto work = [](Batch& b) {
+        for (size_t i; (i = b.next++) < b.count;) {
+            (*b.body)(i);
+            if (++b.done == b.count) { std::lock_guard<std::mutex> guard(b.lock); b.finished.notify_all(); }
+        }
+    };
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (workerCount == 0) {
+            workerCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+            for (size_t i = 0; i < workerCount; i++) std::thread([this] { WorkerLoop(); }).detach();
+        }
+        for (size_t i = 1; i < std::min(count, workerCount + 1); i++) jobs.push_back([batch, work] { work(*batch); });
+    }
+    wake.notify_all();
+    work(*batch);
+    std::unique_lock<std::mutex> wait(batch->lock);
+    batch->finished.wait(wait, [&] { return batch->done == count; });
+}
+void WorkerPool::WorkerLoop() {
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [this] { return !jobs.empty(); });
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        job();
+    }
+}
+void ScanCache::Close() {
+    index.clear(); exeIndex.clear();
+    records = nullptr; exeRecords = nullptr; strings = nullptr; stringCount = 0;
+    mapped.Close();
+}
 void CreateTrayIcon() { g_nid.cbSize = sizeof(NOTIFYICONDATAW); g_nid.hWnd = g_hWnd; g_nid.uID = TRAY_ICON_ID; g_nid.uFlags = NIF_ICON | NIF_MESSAGE | NIF_TIP; g_nid.uCallbackMessage = WM_APP_TRAY_MSG; g_nid.hIcon = LoadIcon(GetModuleHandle(NULL), L"IDI_ICON1"); wcscpy_s(g_nid.szTip, L"WinDeck Nexus"); Shell_NotifyIconW(NIM_ADD, &g_nid); }
 void ShowContextMenu(HWND hwnd) { POINT curPoint; GetCursorPos(&curPoint); HMENU hMenu = CreatePopupMenu(); InsertMenuW(hMenu, 0, MF_BYPOSITION | MF_STRING, ID_MENU_SHOW, L"Show/Hide Frontend"); InsertMenuW(hMenu, 1, MF_BYPOSITION | MF_STRING, ID_MENU_CONFIG, L"Configuration Hub"); InsertMenuW(hMenu, 2, MF_BYPOSITION | MF_STRING, ID_MENU_EXIT, L"Exit"); SetForegroundWindow(hwnd); TrackPopupMenu(hMenu, TPM_RIGHTBUTTON, curPoint.x, curPoint.y, 0, hwnd, NULL); }
 void CreateGuidesWindow(HINSTANCE hInstance) { if (g_guideshWnd) { ShowWindow(g_guideshWnd, SW_SHOW); SetForegroundWindow(g_guideshWnd); return; } WNDCLASSEXW wcex = {}; wcex.cbSize = sizeof(WNDCLASSEXW); wcex.lpfnWndProc = GuidesWndProc; wcex.hInstance = hInstance; wcex.hIcon = LoadIcon(hInstance, L"IDI_ICON1"); wcex.lpszClassName = L"WinDeckGuidesClass"; RegisterClassExW(&wcex); g_guideshWnd = CreateWindowW(L"WinDeckGuidesClass", L"WinDeck Nexus Guides", WS_OVERLAPPEDWINDOW, CW_USEDEFAULT, CW_USEDEFAULT, 1024, 768, nullptr, nullptr, hInstance, nullptr); ShowWindow(g_guideshWnd, SW_SHOW); UpdateWindow(g_guideshWnd); CreateCoreWebView2EnvironmentWithOptions(nullptr, nullptr, nullptr, Microsoft::WRL::Callback<ICoreWebView2CreateCoreWebView2EnvironmentCompletedHandler>([](HRESULT result, ICoreWebView2Environment* env) -> HRESULT { env->CreateCoreWebView2Controller(g_guideshWnd, Microsoft::WRL::Callback<ICoreWebView2CreateCoreWebView2ControllerCompletedHandler>([](HRESULT result, ICoreWebView2Controller* controller) -> HRESULT { Microsoft::WRL::ComPtr<ICoreWebView2> webview; controller->get_CoreWebView2(&webview); RECT bounds; GetClientRect(g_guideshWnd, &bounds); controller->put_Bounds(bounds); webview->Navigate((GetExecutablePath() + L"\\ui\\guides.html").c_str()); return S_OK; }).Get()); return S_OK; }).Get()); }
+bool ChangeWatch::Arm() {
+    ResetEvent(event);
+    if (key) return RegNotifyChangeKeyValue(key, TRUE, REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET, event, TRUE) == ERROR_SUCCESS;
+    overlapped = {};
+    overlapped.hEvent = event;
+    return ReadDirectoryChangesW(directory, buffer.data(), (DWORD)(buffer.size() * sizeof(DWORD)), FALSE,
+        FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE, nullptr, &overlapped, nullptr) != FALSE;
+}
+ChangeWatch::~ChangeWatch() {
+    // A read still in flight writes into buffer, so it has to be cancelled and finished before the buffer goes.
+    if (directory != INVALID_HANDLE_VALUE) { DWORD bytes; CancelIoEx(directory, &overlapped); GetOverlappedResult(directory, &overlapped, &bytes, TRUE); CloseHandle(directory); }
+    if (key) RegCloseKey(key);
+    if (event) CloseHandle(event);
+}
+bool ChangeWatcher::AddDirectory(const std::wstring& dir) {
+    if (watches.size() >= MAXIMUM_WAIT_OBJECTS) return false;
+    auto watch = std::make_unique<ChangeWatch>();
+    watch->path = dir;
+    watch->directory = CreateFileW(dir.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+    if (watch->directory == INVALID_HANDLE_VALUE) return false;
+    watch->buffer.resize(kChangeBufferBytes / sizeof(DWORD));
+    watch->event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!watch->event || !watch->Arm()) return false;
+    watches.push_back(std::move(watch));
+    return true;
+}
+bool ChangeWatcher::AddKey(const std::wstring& key, REGSAM view) {
+    if (watches.size() >= MAXIMUM_WAIT_OBJECTS) return false;
+    auto watch = std::make_unique<ChangeWatch>();
+    watch->path = key;
+    watch->view = view;
+    HKEY root;
+    std::wstring subPath;
+    if (!SplitRegistryPath(key, root, subPath) || RegOpenKeyExW(root, subPath.c_str(), 0, KEY_NOTIFY | view, &watch->key) != ERROR_SUCCESS) return false;
+    watch->event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!watch->event || !watch->Arm()) return false;
+    watches.push_back(std::move(watch));
+    return true;
+}
+bool ChangeWatcher::Wait(DWORD timeout, ChangeEvent& change) {
+    if (watches.empty()) return false;
+    std::vector<HANDLE> events;
+    for (const auto& watch : watches) events.push_back(watch->event);
+    DWORD signaled = WaitForMultipleObjects((DWORD)events.size(), events.data(), FALSE, timeout);
+    if (signaled >= WAIT_OBJECT_0 + events.size()) return false;
+    size_t index = signaled - WAIT_OBJECT_0;
+    ChangeWatch& watch = *watches[index];
+    change.path = watch.path; change.view = watch.view; change.isKey = watch.key != nullptr; change.overflow = false;
+    change.names.clear();
+    bool alive = true;
+    if (!change.isKey) {
+        // Zero bytes means the changes did not fit the buffer; a failed read means the folder itself is gone.
+        DWORD bytes = 0;
+        alive = GetOverlappedResult(watch.directory, &watch.overlapped, &bytes, FALSE) != FALSE;
+        change.overflow = !alive || bytes == 0;
+        for (DWORD offset = 0; alive && bytes;) {
+            const FILE_NOTIFY_INFORMATION* info = (const FILE_NOTIFY_INFORMATION*)((const uint8_t*)watch.buffer.data() + offset);
+            change.names.emplace_back(info->FileName, info->FileNameLength / sizeof(wchar_t));
+            if (!info->NextEntryOffset) break;
+            offset += info->NextEntryOffset;
+        }
+    }
+    if (!alive || !watch.Arm()) watches.erase(watches.begin() + index);
+    return true;
+}
+// Keeps the library current after the startup scan. Steam's steamapps folders and the Uninstall keys are watched, and a change
+// re-reads only what it touched: the manifests a folder reported, or the Uninstall subkeys whose last-write time moved. Bursts,
+// like Steam rewriting a manifest as a download progresses, settle for kWatchSettleMs first. What came, went or changed is
+// queued for the window thread (see ApplyLibraryChanges); the library is never scanned again as a whole.
+void WatchLibrary() {
+    FinishProviderScan();
+    // A snapshot scan has nothing on this PC to watch.
+    if (g_registry.fromSnapshot) return;
+    ChangeWatcher watcher;
+    std::wstring steamPath = GetSteamInstallPath();
+    std::vector<SteamLibrary> libraries;
+    if (!steamPath.empty()) ReadSteamLibraries(steamPath, libraries);
+    for (const auto& library : libraries) watcher.AddDirectory(library.path + L"\\steamapps");
+    for (const auto& view : kUninstallViews) watcher.AddKey(std::wstring(view.hive) + L"\\" + kUninstallKey, view.view);
+    std::unordered_set<std::wstring> manifests, relist;
+    std::vector<char> views(kUninstallViewCount);
+    bool librariesChanged = false;
+    ChangeEvent change;
+    while (g_isAppRunning) {
+        bool pending = !manifests.empty() || !relist.empty() || librariesChanged || std::find(views.begin(), views.end(), 1) != views.end();
+        if (!pending && watcher.watches.empty()) return;
+        if (watcher.Wait(pending ? kWatchSettleMs : INFINITE, change)) {
+            if (change.isKey) {
+                for (size_t v = 0; v < kUninstallViewCount; v++) if (change.view == kUninstallViews[v].view && change.path == std::wstring(kUninstallViews[v].hive) + L"\\" + kUninstallKey) views[v] = 1;
+            }
+            else if (change.overflow) relist.insert(change.path);
+            else for (const auto& name : change.names) {
+                // Steam saves manifests under other names first; only the finished appmanifest_<appid>.acf counts.
+                if (_wcsicmp(name.c_str(), L"libraryfolders.vdf") == 0) librariesChanged = true;
+                else if (name.rfind(L"appmanifest_", 0) == 0 && name.size() > 16 && _wcsicmp(name.c_str() + name.size() - 4, L".acf") == 0) manifests.insert(change.path + L"\\" + name);
+            }
+            continue;
+        }
+        if (!pending) continue;
+        std::vector<LibraryChange> changes;
+        // A library added in Steam is watched from now on and everything already in it is read.
+        if (librariesChanged) {
+            std::vector<SteamLibrary> current;
+            ReadSteamLibraries(steamPath, current);
+            for (const auto& library : current) {
+                if (std::any_of(libraries.begin(), libraries.end(), [&](const SteamLibrary& known) { return _wcsicmp(known.path.c_str(), library.path.c_str()) == 0; })) continue;
+                watcher.AddDirectory(library.path + L"\\steamapps");
+                relist.insert(library.path + L"\\steamapps");
+                libraries.push_back(library);
+            }
+        }
+        // A folder that lost track is listed again; manifests it had before and no longer lists count as removed.
+        for (const auto& steamappsPath : relist) {
+            std::vector<std::wstring> listed;
+            ListSteamManifests(steamappsPath, listed);
+            for (const auto& name : listed) manifests.insert(steamappsPath + L"\\" + name);
+            std::wstring prefix = steamappsPath + L"\\appmanifest_";
+            for (const auto& source : g_librarySources) if (source.first.rfind(prefix, 0) == 0) manifests.insert(source.first);
+        }
+        for (const auto& manifest : manifests) UpdateSteamManifest(manifest, steamPath + L"\\appcache\\appinfo.vdf", changes);
+        for (size_t v = 0; v < kUninstallViewCount; v++) if (views[v]) UpdateUninstallView(kUninstallViews[v], changes);
+        manifests.clear(); relist.clear(); librariesChanged = false;
+        std::fill(views.begin(), views.end(), 0);
+        // Re-read sources went into the cache (see UpdateLibrarySource), so the next start finds them decoded.
+        if (!g_registry.fromSnapshot) g_scanCache.Save(GetExecutablePath() + L"\\library.cache");
+        if (changes.empty()) continue;
+        std::lock_guard<std::mutex> guard(g_libraryChangesLock);
+        g_libraryChanges.insert(g_libraryChanges.end(), std::make_move_iterator(changes.begin()), std::make_move_iterator(changes.end()));
+        PostMessageW(g_hWnd, WM_APP_LIBRARY_CHANGED, 0, 0);
+    }
+}
+void UpdateSteamManifest(const std::wstring& manifestPath, const std::wstring& appInfoPath, std::vector<LibraryChange>& changes) {
+    FileStamp stamp;
+    Game game;
+    bool present = GetFileStamp(manifestPath, stamp);
+    auto known = g_librarySources.find(manifestPath);
+    if (present && known != g_librarySources.end() && known->second.stamp.mtime == stamp.mtime && known->second.stamp.size == stamp.size) return;
+    if (present) ParseSteamManifest(manifestPath.substr(0, manifestPath.rfind(L'\\')), manifestPath, appInfoPath, game);
+    UpdateLibrarySource(manifestPath, present, stamp, game, changes);
+}
+// Enumerating the subkeys is cheap and brings their last-write times along, so only new or rewritten subkeys are read and
+// only subkeys that vanished are looked for among the known ones.
+void UpdateUninstallView(const UninstallView& view, std::vector<LibraryChange>& changes) {
+    std::vector<RegistrySubkey> subkeys;
+    if (!g_registry.ListSubkeys(std::wstring(view.hive) + L"\\" + kUninstallKey, subkeys, view.view)) return;
+    std::unordered_set<std::wstring> listed;
+    for (const auto& subkey : subkeys) {
+        UninstallEntry entry = MakeUninstallEntry(view, subkey);
+        listed.insert(entry.cacheKey);
+        auto known = g_librarySources.find(entry.cacheKey);
+        if (known != g_librarySources.end() && known->second.stamp.mtime == entry.stamp.mtime) continue;
+        ReadUninstallEntry(entry);
+        if (IsGameCandidate(entry) && !IsClaimedInstall(entry.location)) ResolveUninstallEntry(entry);
+        UpdateLibrarySource(entry.cacheKey, true, entry.stamp, entry.game, changes);
+    }
+    std::wstring prefix = std::wstring(view.cachePrefix) + L"\\" + kUninstallKey + L"\\";
+    std::vector<std::wstring> removed;
+    for (const auto& source : g_librarySources) if (source.first.rfind(prefix, 0) == 0 && !listed.count(source.first)) removed.push_back(source.first);
+    for (const auto& key : removed) UpdateLibrarySource(key, false, {}, Game(), changes);
+}
+// Records what a source produces now and queues the difference. A game another source also supplies is still recorded here,
+// so the record both went into survives either one going away, as MergeDuplicateGames kept one record for both at startup.
+// The cache gets what the source itself produced, as the startup scan stores it.
+void UpdateLibrarySource(const std::wstring& key, bool present, const FileStamp& stamp, Game game, std::vector<LibraryChange>& changes) {
+    if (present) g_scanCache.Store(key, stamp, game);
+    else g_scanCache.Forget(key);
+    auto known = g_librarySources.find(key);
+    Game previous = known != g_librarySources.end() ? std::move(known->second.game) : Game();
+    if (present) g_librarySources[key] = {stamp, game};
+    else if (known != g_librarySources.end()) g_librarySources.erase(known);
+    bool keepScanner = false;
+    if (!previous.path.empty()) {
+        std::wstring pathKey = g_canonicalPaths.Key(previous.path);
+        for (const auto& source : g_librarySources) {
+            const Game& other = source.second.game;
+            if (source.first != key && !other.path.empty() && other.source == previous.source && SharesLaunch(other, previous) && g_canonicalPaths.Key(other.path) == pathKey) { keepScanner = true; break; }
+        }
+    }
+    if (!previous.path.empty() || !game.path.empty()) changes.push_back({std::move(previous), keepScanner, std::move(game)});
+}
+// Runs on the window thread, which owns g_gameLibrary. The frontend gets the same delta, {"removed": [keys], "games": [games
+// added or changed]}, instead of the whole library again; records go by GameKey, as their tiles do. A source's game is found in the record it went into the way
+// MergeDuplicateGames put it there: canonical path and a launch the two share.
+void ApplyLibraryChanges() {
+    std::vector<LibraryChange> changes;
+    { std::lock_guard<std::mutex> guard(g_libraryChangesLock); changes.swap(g_libraryChanges); }
+    auto recordFor = [](const Game& supplied) {
+        std::wstring pathKey = g_canonicalPaths.Key(supplied.path);
+        return std::find_if(g_gameLibrary.begin(), g_gameLibrary.end(), [&](const Game& game) { return SharesLaunch(game, supplied) && g_canonicalPaths.Key(game.path) == pathKey; });
+    };
+    std::unordered_set<std::wstring> removed, changed;
+    for (auto& change : changes) {
+        auto record = change.previous.path.empty() ? g_gameLibrary.end() : recordFor(change.previous);
+        bool reread = record != g_gameLibrary.end() && !change.game.path.empty() && SharesLaunch(change.previous, change.game)
+            && g_canonicalPaths.Key(change.previous.path) == g_canonicalPaths.Key(change.game.path);
+        // The source no longer supplies that install: only its scanner leaves the record, which goes once none is left.
+        if (record != g_gameLibrary.end() && !reread) {
+            if (record->foundBy.empty()) record->foundBy.push_back(record->source);
+            if (!change.keepScanner) record->foundBy.erase(std::remove(record->foundBy.begin(), record->foundBy.end(), change.previous.source), record->foundBy.end());
+            if (record->foundBy.empty()) { removed.insert(GameKey(*record)); g_gameLibrary.erase(record); }
+            else {
+                if (record->source == change.previous.source && !change.keepScanner) record->source = record->foundBy.front();
+                changed.insert(GameKey(*record));
+            }
+        }
+        if (change.game.path.empty()) continue;
+        if (!reread) record = recordFor(change.game);
+        if (record == g_gameLibrary.end()) {
+            changed.insert(GameKey(change.game));
+            g_gameLibrary.push_back(std::move(change.game));
+            continue;
+        }
+        removed.insert(GameKey(*record));
+        if (reread && record->source == change.game.source) {
+            // The record is this scanner's own, re-read: the new fields replace it. Play history is read with the startup
+            // scan only, and the other scanners that found the install still did.
+            if (change.game.appId == record->appId && !change.game.lastPlayed) { change.game.lastPlayed = record->lastPlayed; change.game.playtimeMinutes = record->playtimeMinutes; }
+            change.game.foundBy = std::move(record->foundBy);
+            *record = std::move(change.game);
+        }
+        else MergeGameRecord(*record, std::move(change.game));
+        changed.insert(GameKey(*record));
+    }
+    std::wstring removedJson, games;
+    for (const auto& game : g_gameLibrary) {
+        std::wstring key = GameKey(game);
+        removed.erase(key);
+        if (changed.count(key)) games += GameToJson(game) + L",";
+    }
+    for (const auto& key : removed) removedJson += L"\"" + JsonEscape(key) + L"\",";
+    if (!g_webview || (removedJson.empty() && games.empty())) return;
+    if (!removedJson.empty()) removedJson.pop_back();
+    if (!games.empty()) games.pop_back();
+    g_webview->PostWebMessageAsJson((L"{\"removed\":[" + removedJson + L"],\"games\":[" + games + L"]}").c_str());
+}
 LRESULT CALLBACK GuidesWndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) { if (message == WM_DESTROY) { g_guideshWnd = nullptr; return 0; } return DefWindowProcW(hWnd, message, wParam, lParam); }
+// Where launchers keep machine-wide data (normally C:\ProgramData); empty if the variable is missing.
+std::wstring GetProgramDataPath() {
+    wchar_t path[MAX_PATH];
+    DWORD length = GetEnvironmentVariableW(L"ProgramData", path, MAX_PATH);
+    return length != 0 && length < MAX_PATH ? std::wstring(path, length) : L"";
+}
 std::wstring GetExecutablePath() { wchar_t path[MAX_PATH] = { 0 }; GetModuleFileNameW(NULL, path, MAX_PATH); *wcsrchr(path, L'\\') = L'\0'; return std::wstring(path); }
\ No newline at end of file
@@ -0,0 +1,127 @@
+// Fixture tests for the readers that turn launcher and ROM files into games. The app is one translation unit, so it is
+// included whole; its WinMain goes unused in this console program. Build and run from the repository root (see the
+// workflow, which links it like the app but as /SUBSYSTEM:CONSOLE), where the fixtures are found as tests\fixtures\...
+#include "../Windeck-Nexus.cpp"
+#include <cstdio>
+
+int g_failures = 0;
+#define CHECK(condition) do { if (!(condition)) { g_failures++; printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #condition); } } while (0)
+
+// A two-track CD: the sheet is the one game, whether the tracks' extension is listed too or every file is a candidate.
+void TestRomSheets() {
+    for (const auto& extensions : { std::vector<std::wstring>{ L"cue", L"bin" }, std::vector<std::wstring>{} }) {
+        RomSystem system;
+        system.folder = L"tests\\fixtures\\roms\\cue";
+        system.extensions = extensions;
+        std::vector<RomFile> files;
+        ListRomFiles(system, 0, files);
+        std::vector<std::wstring> names;
+        for (const auto& file : files) names.push_back(file.path.substr(file.path.rfind(L'\\') + 1));
+        std::sort(names.begin(), names.end());
+        CHECK(names == (std::vector<std::wstring>{ L"Cartridge.bin", L"Game.cue" }));
+    }
+    std::vector<std::wstring> names;
+    ReadRomSheet("3\n1 0 4 2352 track01.bin 0\n2 600 0 2352 \"track 02.raw\" 0\n3 45000 4 2352 track03.bin 0\n", L"gdi", names);
+    CHECK(names == (std::vector<std::wstring>{ L"track01.bin", L"track 02.raw", L"track03.bin" }));
+    names.clear();
+    ReadRomSheet("\xEF\xBB\xBF# Final Fantasy VII\nDisc 1.chd\r\n\nDisc 2.chd\n", L"m3u", names);
+    CHECK(names == (std::vector<std::wstring>{ L"Disc 1.chd", L"Disc 2.chd" }));
+    names.clear();
+    ReadRomSheet("REM GENRE Action\nfile Game.bin BINARY\n  TRACK 01 MODE1/2352\nFILE", L"cue", names);
+    CHECK(names == (std::vector<std::wstring>{ L"Game.bin" }));
+}
+
+// A minimal PE32+ image: headers, then one .rsrc section at RVA 0x2000 holding an RT_VERSION resource with a ProductName.
+// characteristics goes into the COFF header as is; 0x22 is an executable image that handles large addresses.
+std::vector<uint8_t> MakePeImage(uint16_t machine, uint16_t subsystem, uint16_t characteristics, const std::wstring& productName) {
+    std::vector<uint8_t> image(0x400);
+    auto put16 = [](std::vector<uint8_t>& out, size_t at, uint32_t value) { if (out.size() < at + 2) out.resize(at + 2); out[at] = (uint8_t)value; out[at + 1] = (uint8_t)(value >> 8); };
+    auto put32 = [&put16](std::vector<uint8_t>& out, size_t at, uint32_t value) { put16(out, at, value & 0xFFFF); put16(out, at + 2, value >> 16); };
+    // VS_VERSIONINFO blocks: wLength, wValueLength, wType, the key and its value, each padded to 4 bytes, then the children.
+    std::function<std::vector<uint8_t>(const std::wstring&, const std::vector<uint8_t>&, uint16_t, const std::vector<std::vector<uint8_t>>&)> block =
+        [&](const std::wstring& key, const std::vector<uint8_t>& value, uint16_t valueLength, const std::vector<std::vector<uint8_t>>& children) {
+            std::vector<uint8_t> out(6);
+            for (wchar_t c : key + L'\0') put16(out, out.size(), c);
+            out.resize((out.size() + 3) & ~(size_t)3);
+            out.insert(out.end(), value.begin(), value.end());
+            for (const auto& child : children) { out.resize((out.size() + 3) & ~(size_t)3); out.insert(out.end(), child.begin(), child.end()); }
+            put16(out, 0, (uint32_t)out.size());
+            put16(out, 2, valueLength);
+            put16(out, 4, valueLength == 52 ? 0 : 1);
+            return out;
+        };
+    std::vector<uint8_t> name;
+    for (wchar_t c : productName + L'\0') put16(name, name.size(), c);
+    std::vector<uint8_t> version = block(L"VS_VERSION_INFO", std::vector<uint8_t>(52), 52, {
+        block(L"StringFileInfo", {}, 0, { block(L"040904b0", {}, 0, { block(L"ProductName", name, (uint16_t)(productName.size() + 1), {}) }) }) });
+    // Resource tree at the start of the section: type 16 -> name 1 -> language 0x409 -> data entry -> the version block.
+    std::vector<uint8_t> resources(0x58);
+    put16(resources, 0x0E, 1); put32(resources, 0x10, 16); put32(resources, 0x14, 0x80000000 | 0x18);
+    put16(resources, 0x26, 1); put32(resources, 0x28, 1); put32(resources, 0x2C, 0x80000000 | 0x30);
+    put16(resources, 0x3E, 1); put32(resources, 0x40, 0x409); put32(resources, 0x44, 0x48);
+    put32(resources, 0x48, 0x2000 + 0x58); put32(resources, 0x4C, (uint32_t)version.size());
+    resources.insert(resources.end(), version.begin(), version.end());
+    const size_t pe = 0x80, optional = pe + 24, section = optional + 240;
+    put16(image, 0, 0x5A4D); put32(image, 0x3C, pe); put32(image, pe, 0x00004550);
+    put16(image, pe + 4, machine); put16(image, pe + 6, 1); put16(image, pe + 20, 240); put16(image, pe + 22, characteristics);
+    put16(image, optional, 0x20B); put16(image, optional + 68, subsystem); put32(image, optional + 108, 16);
+    put32(image, optional + 112 + 2 * 8, 0x2000); put32(image, optional + 112 + 2 * 8 + 4, (uint32_t)resources.size());
+    memcpy(&image[section], ".rsrc", 5);
+    put32(image, section + 8, (uint32_t)resources.size()); put32(image, section + 12, 0x2000);
+    put32(image, section + 16, (uint32_t)resources.size()); put32(image, section + 20, 0x400);
+    image.resize(0x400);
+    image.insert(image.end(), resources.begin(), resources.end());
+    return image;
+}
+
+// Header fixtures for exe ranking: what ParsePeHeaders reads from each, and how ScorePeInfo ranks them for the game.
+void TestPeHeaders() {
+    PeInfo gui, console, dll, truncated, garbage;
+    std::vector<uint8_t> image = MakePeImage(kPeMachineAmd64, kPeSubsystemGui, 0x22, L"Hollow Knight");
+    CHECK(ParsePeHeaders(image.data(), image.size(), gui));
+    CHECK(gui.machine == kPeMachineAmd64 && gui.subsystem == kPeSubsystemGui && !gui.isDll && !gui.isSigned && !gui.installerStub);
+    CHECK(gui.productName == L"Hollow Knight");
+    image = MakePeImage(0x14C, kPeSubsystemConsole, 0x102, L"Crash Reporter");
+    CHECK(ParsePeHeaders(image.data(), image.size(), console));
+    CHECK(console.machine == 0x14C && console.subsystem == kPeSubsystemConsole && console.productName == L"Crash Reporter");
+    image = MakePeImage(kPeMachineAmd64, kPeSubsystemGui, 0x2022, L"Hollow Knight");
+    CHECK(ParsePeHeaders(image.data(), image.size(), dll) && dll.isDll);
+    CHECK(ScorePeInfo(gui, L"Hollow Knight") > ScorePeInfo(gui, L"Silksong"));
+    CHECK(ScorePeInfo(gui, L"Hollow Knight") > ScorePeInfo(console, L"Hollow Knight"));
+    CHECK(ScorePeInfo(dll, L"Hollow Knight") == INT_MIN);
+    // Cut inside the resource section, the headers still parse and the version resource is simply missing.
+    image.resize(0x420);
+    CHECK(ParsePeHeaders(image.data(), image.size(), truncated) && truncated.productName.empty());
+    image.resize(0x90);
+    CHECK(!ParsePeHeaders(image.data(), image.size(), truncated));
+    const char noise[] = "MZ\x90\0\x03\0\0\0\x04\0\0\0\xFF\xFF\0\0This program cannot be run in DOS mode.";
+    CHECK(!ParsePeHeaders((const uint8_t*)noise, sizeof(noise), garbage));
+    CHECK(!ParsePeHeaders(nullptr, 0, garbage));
+}
+
+// Epic .item fixtures: a finished game install, one still downloading and an add-on installed into its game's folder.
+void TestEpicManifests() {
+    auto parse = [](const wchar_t* name, EpicManifest& manifest) {
+        std::string data;
+        return ReadFileBytes(std::wstring(L"tests\\fixtures\\epic\\") + name, data) && ParseEpicManifest(data, manifest);
+    };
+    EpicManifest installed, incomplete, addon, broken;
+    CHECK(parse(L"Installed.item", installed));
+    CHECK(installed.isGame && !installed.incomplete);
+    CHECK(installed.displayName == L"Hades II" && installed.appName == L"Pumpkin" && installed.launchCommand == L"-nosplash");
+    CHECK(installed.exePath == L"D:\\Epic Games\\HadesII\\Binaries\\Win64\\HadesII.exe");
+    CHECK(installed.installSize == 10952736128ull);
+    CHECK(parse(L"Incomplete.item", incomplete));
+    CHECK(incomplete.incomplete && incomplete.appName == L"Moth");
+    CHECK(parse(L"Addon.item", addon));
+    CHECK(!addon.isGame && addon.appName == L"PumpkinSoundtrack");
+    CHECK(!ParseEpicManifest("{\"DisplayName\": \"Cut off", broken));
+}
+
+int main() {
+    TestRomSheets();
+    TestPeHeaders();
+    TestEpicManifests();
+    printf(g_failures ? "%d check(s) failed\n" : "All checks passed\n", g_failures);
+    return g_failures ? 1 : 0;
+}